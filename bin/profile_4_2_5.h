@@ -0,0 +1,63 @@
+#define X _PROFILE(X)
+#define _count_trailing_zeros _PROFILE(_count_trailing_zeros)
+#define _create_leaf _PROFILE(_create_leaf)
+#define _get_parent _PROFILE(_get_parent)
+#define _get_pkey _PROFILE(_get_pkey)
+#define _init_state _PROFILE(_init_state)
+#define _leaf_hash _PROFILE(_leaf_hash)
+#define _nextAuth _PROFILE(_nextAuth)
+#define _retain_pop _PROFILE(_retain_pop)
+#define _retain_push _PROFILE(_retain_push)
+#define _stack_pop _PROFILE(_stack_pop)
+#define _stack_push _PROFILE(_stack_push)
+#define _treehash_get_tailheight _PROFILE(_treehash_get_tailheight)
+#define _treehash_height _PROFILE(_treehash_height)
+#define _treehash_initialize _PROFILE(_treehash_initialize)
+#define _treehash_set_tailheight _PROFILE(_treehash_set_tailheight)
+#define _treehash_state _PROFILE(_treehash_state)
+#define _treehash_update _PROFILE(_treehash_update)
+#define deserialize_mss_node _PROFILE(deserialize_mss_node)
+#define deserialize_mss_signature _PROFILE(deserialize_mss_signature)
+#define deserialize_mss_skey _PROFILE(deserialize_mss_skey)
+#define deserialize_mss_state _PROFILE(deserialize_mss_state)
+#define init_state _PROFILE(init_state)
+#define mss_deferred_drain _PROFILE(mss_deferred_drain)
+#define mss_deferred_start _PROFILE(mss_deferred_start)
+#define mss_deferred_stop _PROFILE(mss_deferred_stop)
+#define mss_hypertree_keygen _PROFILE(mss_hypertree_keygen)
+#define mss_hypertree_sign _PROFILE(mss_hypertree_sign)
+#define mss_hypertree_verify _PROFILE(mss_hypertree_verify)
+#define mss_keygen _PROFILE(mss_keygen)
+#define mss_keygen_core _PROFILE(mss_keygen_core)
+#define mss_keygen_core_mt _PROFILE(mss_keygen_core_mt)
+#define mss_keygen_core_shards _PROFILE(mss_keygen_core_shards)
+#define mss_keygen_mode _PROFILE(mss_keygen_mode)
+#define mss_presign_leaf _PROFILE(mss_presign_leaf)
+#define mss_sign _PROFILE(mss_sign)
+#define mss_sign_core _PROFILE(mss_sign_core)
+#define mss_sign_core_deferred _PROFILE(mss_sign_core_deferred)
+#define mss_sign_core_grind _PROFILE(mss_sign_core_grind)
+#define mss_sign_core_iov _PROFILE(mss_sign_core_iov)
+#define mss_sign_core_presigned _PROFILE(mss_sign_core_presigned)
+#define mss_verify _PROFILE(mss_verify)
+#define mss_verify_core _PROFILE(mss_verify_core)
+#define mss_verify_core_iov _PROFILE(mss_verify_core_iov)
+#define mss_verify_stream_final _PROFILE(mss_verify_stream_final)
+#define mss_verify_stream_init _PROFILE(mss_verify_stream_init)
+#define mss_verify_stream_update _PROFILE(mss_verify_stream_update)
+#define serialize_mss_node _PROFILE(serialize_mss_node)
+#define serialize_mss_signature _PROFILE(serialize_mss_signature)
+#define serialize_mss_skey _PROFILE(serialize_mss_skey)
+#define serialize_mss_state _PROFILE(serialize_mss_state)
+#define winternitz_chaining _PROFILE(winternitz_chaining)
+#define winternitz_chunks _PROFILE(winternitz_chunks)
+#define winternitz_keygen _PROFILE(winternitz_keygen)
+#define winternitz_keygen_cache _PROFILE(winternitz_keygen_cache)
+#define winternitz_sign _PROFILE(winternitz_sign)
+#define winternitz_sign_cache _PROFILE(winternitz_sign_cache)
+#define winternitz_sign_chains _PROFILE(winternitz_sign_chains)
+#define winternitz_verify _PROFILE(winternitz_verify)
+#define winternitz_verify_cost _PROFILE(winternitz_verify_cost)
+#define winternitz_verify_final _PROFILE(winternitz_verify_final)
+#define winternitz_verify_init _PROFILE(winternitz_verify_init)
+#define winternitz_verify_update _PROFILE(winternitz_verify_update)
@@ -23,6 +23,20 @@
 
 void aes128_encrypt_keyexpanded(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE]);//, const unsigned char expandedKey[11*AES_128_KEY_SIZE]);
 void aes_128_encrypt(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]);
+void aes_128_encrypt_ti(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]); // portable backend, see dispatch.h
+
+/**
+ * Batch versions of aes_128_encrypt and aes128_encrypt_keyexpanded over n independent blocks.
+ * ciphertext[i] may alias plaintext[i] (and key[i]).
+ */
+void aes_128_encrypt_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n);
+void aes128_encrypt_keyexpanded_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], unsigned int n);
+
+/**
+ * The portable batch backends, see dispatch.h. expandedKey holds the 11 round keys.
+ */
+void aes_128_encrypt_ti_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n);
+void aes_128_encrypt_expanded_ti_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char expandedKey[11 * AES_128_KEY_SIZE], unsigned int n);
 
 #ifdef AES_ENC_DEC
     #ifdef AES_CBC_MODE
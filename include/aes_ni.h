@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AES_NI_H
+#define __AES_NI_H
+
+#include "aes_128.h"
+#include "cpu.h"
+
+#define AES_NI_LANES    4 // blocks interleaved by one pass of the _x functions
+
+#ifdef CPU_X86
+
+/**
+ * AES-128 encryption of one block with the AES-NI instructions. The round keys are derived on the fly,
+ * each one just ahead of the aesenc that uses it, so a fresh key costs no separate expansion pass.
+ * Only call when cpu_features() reports CPU_AESNI (which implies SSSE3).
+ */
+void aes_128_encrypt_ni(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]);
+
+/**
+ * n independent encryptions, each under its own key, AES_NI_LANES at a time with their rounds interleaved
+ * so that the aesenc latencies of one block are hidden behind the others.
+ * ciphertext[i] may alias plaintext[i] or key[i]. Same requirements as aes_128_encrypt_ni.
+ */
+void aes_128_encrypt_ni_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n);
+
+/**
+ * n independent encryptions under one already expanded key (11 round keys, as produced by expandKey).
+ */
+void aes_128_encrypt_expanded_ni_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char expandedKey[11 * AES_128_KEY_SIZE], unsigned int n);
+
+#endif // CPU_X86
+
+#endif // __AES_NI_H
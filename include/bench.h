@@ -20,10 +20,13 @@
 
 enum BENCH {
 	BENCH_MSS,
+	BENCH_MSS_MMO,
+	BENCH_MSS_BUDGET,
 	BENCH_HASH
 };
 
 void do_bench(enum BENCH operation);
 void bench_hash();
+void bench_mss_budget();
 
 #endif // __BENCH
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CPU_H
+#define __CPU_H
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CPU_X86 1
+#endif
+
+#define CPU_SSE41       0x01
+#define CPU_AVX2        0x02
+#define CPU_AVX512      0x04 // AVX-512 F
+#define CPU_SHANI       0x08
+#define CPU_AESNI       0x10
+
+/**
+ * Probe the processor (cpuid) and the OS (xgetbv) once and return the set of usable CPU_* features.
+ * On non-x86 targets this always returns 0, so callers fall back to the portable code.
+ */
+unsigned int cpu_features(void);
+
+#endif // __CPU_H
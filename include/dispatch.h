@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DISPATCH_H
+#define __DISPATCH_H
+
+#include "sph_types.h"
+#include "cpu.h"
+
+#define DISPATCH_ENV        "MSS_BACKEND" // environment variable read by dispatch_init
+#define DISPATCH_NAME_SIZE  64
+
+/**
+ * The primitive implementations used by the library. The table starts out with the portable code,
+ * so it is usable before dispatch_init has run, and is upgraded once at library load.
+ */
+struct dispatch_table {
+    unsigned int features;                  // CPU_* features the installed implementations rely on
+    char name[DISPATCH_NAME_SIZE];          // human readable summary, e.g. for benchmark reports
+    void (*comp)(const unsigned char *data, sph_u32 val[8]); // SHA-256 compression of one 64-byte block
+    void (*mb_comp)(sph_u32 val[][8], const unsigned char *const block[], unsigned int n); // see sha256_mb_comp
+    unsigned int mb_lanes;                  // see sha256_mb_lanes
+    void (*prf32)(const unsigned char key[32], const unsigned char input[32], unsigned char output[32]); // see prg32
+    void (*aes_enc)(unsigned char ciphertext[16], const unsigned char plaintext[16], const unsigned char key[16]); // see aes_128_encrypt
+    void (*aes_enc_x)(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n); // see aes_128_encrypt_x
+    void (*aes_enc_expanded_x)(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char expandedKey[176], unsigned int n); // see aes128_encrypt_keyexpanded_x
+};
+
+extern struct dispatch_table dispatch;
+
+/**
+ * Probe the CPU and install the fastest implementations it supports. If the environment variable
+ * MSS_BACKEND is set, only the features it names are used (see dispatch_force).
+ * This runs automatically before main when built with GCC or Clang, otherwise call it once at startup.
+ */
+void dispatch_init(void);
+
+/**
+ * Install the fastest implementations using only the given CPU_* features (and the CPU supports).
+ */
+void dispatch_select(unsigned int features);
+
+/**
+ * Restrict the backends to a named feature set and reinstall them. Names are "ref" (portable code only),
+ * "avx2", "avx512", "shani", "aesni" and "native" (everything the CPU has), and can be combined with '+',
+ * e.g. "avx512+shani". Not thread safe: call it before the library is used from several threads.
+ *
+ * @param backend   the feature set name
+ * @return 1 if the name was understood, 0 otherwise (the table is then unchanged)
+ */
+int dispatch_force(const char *backend);
+
+#endif // __DISPATCH_H
@@ -18,13 +18,16 @@
 #ifndef __HASH_H
 #define __HASH_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "aes_128.h"
 #include "sph_sha2.h"
+#include "sha2_mb.h"
 
 //#define HASH_BLOCKSIZE AES_128_BLOCK_SIZE
 #define HASH_BLOCKSIZE 64 // SHA256 block size is 512 bits
 #define HASH_OUTPUTSIZE 32 // SHA256 output size is 256 bits
+#define HASH_MAX_LANES SHA256_MB_MAX_LANES // widest multi-buffer engine, batches are split in groups of this size
 
 typedef struct {
     unsigned char H[AES_128_KEY_SIZE]; // hash chaining state
@@ -33,6 +36,27 @@ typedef struct {
     unsigned int n; // total message length
 } mmo_t;
 
+/**
+ * Keyed PRF context: the HMAC inner and outer SHA-256 states right after the key pads
+ * were compressed, so that each evaluation under the same key only compresses the message
+ * and the inner digest.
+ */
+typedef struct {
+    sph_sha256_context inner; // midstate after i_key_pad
+    sph_sha256_context outer; // midstate after o_key_pad
+} hmac_t;
+
+/**
+ * Randomized hashing context, see etcr_init.
+ */
+typedef struct {
+    sph_u32 val[8];                     // SHA-256 chaining value
+    unsigned char rp[HASH_BLOCKSIZE];   // the salt expanded to one block
+    unsigned char buf[HASH_BLOCKSIZE];  // randomized bytes of the pending partial block
+    unsigned int t;                     // number of bytes in buf
+    uint64_t blocks;                    // number of blocks compressed so far
+} etcr_t;
+
 void MMO_init(mmo_t *mmo);
 void MMO_update(mmo_t *mmo, const unsigned char *M, unsigned int m);
 void MMO_final(mmo_t *mmo, unsigned char tag[AES_128_BLOCK_SIZE]);
@@ -40,18 +64,46 @@ void MMO_hash16(mmo_t *mmo, const unsigned char M[AES_128_BLOCK_SIZE], unsigned
 void MMO_hash32(mmo_t *mmo, const unsigned char M1[AES_128_BLOCK_SIZE], const unsigned char M2[AES_128_BLOCK_SIZE], unsigned char tag[AES_128_BLOCK_SIZE]);
 void hash32(const unsigned char *in, unsigned int inlen, unsigned char *out);
 
+/**
+ * Batch versions of MMO_hash16 and MMO_hash32 over n independent inputs, whose AES calls go through
+ * aes_128_encrypt_x so that the blocks are pipelined by the AES-NI backend. Lane i produces exactly
+ * what the scalar function produces for the i-th inputs, and tag[i] may alias any input of lane i.
+ */
+void MMO_hash16_x(const unsigned char *const M[], unsigned char *const tag[], unsigned int n);
+void MMO_hash32_x(const unsigned char *const M1[], const unsigned char *const M2[], unsigned char *const tag[], unsigned int n);
+
+/**
+ * hash32 for the two fixed input sizes of the tree: a 32-byte value (leaf = Hash(v)) and the
+ * 64-byte concatenation of two 32-byte children (parent = Hash(left || right)). The padding is
+ * built in registers instead of going through the generic sphlib buffering.
+ */
+void hash32_fixed32(const unsigned char in[HASH_OUTPUTSIZE], unsigned char out[HASH_OUTPUTSIZE]);
+void hash32_fixed64(const unsigned char left[HASH_OUTPUTSIZE], const unsigned char right[HASH_OUTPUTSIZE], unsigned char out[HASH_OUTPUTSIZE]);
+
 /**
  * The randomized hashing (enhanced target collision resistance (eTCR) notion) described by Halevi and Krawczyk at CRYPTO'06
  * cf. for example https://tools.ietf.org/html/draft-irtf-cfrg-rhash-01 
  * With this technique the underlying hash function doesn't need to be collision resistant so that off-line collision attacks are avoided.
- * 
+ *
+ * The salt r is repeated (and truncated) to one block rp, the data is padded with a 1 bit and zeros to
+ * whole blocks d1,d2,...,dt, and h = H(rp, d1 xor rp, ..., dt xor rp).
+ *
  * @param r         The application salt
  * @param rlen   
  * @param data      The original plain data d=(d1,d2,...) to be signed
  * @param datalen
  * @param h         The hash of the randomized data (H(rp,d1 xor rp,d2 xor rp,...)
  */
-void etcr_hash(const unsigned char *r, const unsigned char rlen, const char *data, const unsigned short datalen, unsigned char *h);
+void etcr_hash(const unsigned char *r, unsigned int rlen, const char *data, size_t datalen, unsigned char *h);
+
+/**
+ * Incremental etcr_hash: etcr_init(ctx, r, rlen), any number of etcr_update calls and etcr_final give the
+ * same h as etcr_hash over the concatenated data. The salt is XORed into each block as it is fed to
+ * SHA-256, so the data is read once and the stack use does not depend on its length.
+ */
+void etcr_init(etcr_t *ctx, const unsigned char *r, unsigned int rlen);
+void etcr_update(etcr_t *ctx, const void *data, size_t datalen);
+void etcr_final(etcr_t *ctx, unsigned char h[HASH_OUTPUTSIZE]);
 
 /**
  * HMAC, a provable PseudoRandom Function based on hash functions
@@ -64,8 +116,26 @@ void etcr_hash(const unsigned char *r, const unsigned char rlen, const char *dat
  */
 void hmac(const unsigned char *key, unsigned int keylen, const unsigned char *message, unsigned int msglen, unsigned char *output);
 
+/**
+ * Precompute the HMAC midstates for key, see hmac_t.
+ */
+void hmac_init(hmac_t *prf, const unsigned char *key, unsigned int keylen);
+
+/**
+ * Evaluate the HMAC keyed by hmac_init on message, same output as hmac() with that key.
+ * The context is not modified and can be reused for any number of evaluations.
+ */
+void hmac_eval(const hmac_t *prf, const unsigned char *message, unsigned int msglen, unsigned char *output);
+
 void prg(const unsigned char seed[32], uint64_t input, unsigned char output[32]);
 
+/**
+ * prg with the seed expanded once: prg_init(prf, seed) followed by prg_eval(prf, i, out)
+ * gives the same out as prg(seed, i, out).
+ */
+void prg_init(hmac_t *prf, const unsigned char seed[32]);
+void prg_eval(const hmac_t *prf, uint64_t input, unsigned char output[32]);
+
 /**
  * An implementation of the Pseudorandom function family suggested at section 2 of 
  * "Forward secure signatures on smart cards" by Hulsing, Busold and Buchmann
@@ -75,6 +145,15 @@ void prg(const unsigned char seed[32], uint64_t input, unsigned char output[32])
  */
 void prg32(const unsigned char key[32], const unsigned char input[32], unsigned char output[32]);
 
+/**
+ * The prg32 implementations installed by the dispatch layer (dispatch.h): the generic HMAC code, and a
+ * straight-line version for the SHA extensions which compresses both key pads in one interleaved pass.
+ */
+void prg32_sph(const unsigned char key[32], const unsigned char input[32], unsigned char output[32]);
+#ifdef CPU_X86
+void prg32_ni(const unsigned char key[32], const unsigned char input[32], unsigned char output[32]);
+#endif
+
 /**
  * Forward secure pseudorandom generator as suggested in 
  * "Forward secure signatures on smart cards" by Hulsing, Busold and Buchmann
@@ -84,5 +163,29 @@ void prg32(const unsigned char key[32], const unsigned char input[32], unsigned
  */
 void fsgen(const unsigned char seed[32], unsigned char nextseed[32], unsigned char rand[32]);
 
+/**
+ * Batch versions of hash32, prg and prg32 over n independent inputs, computed in lockstep
+ * by the multi-buffer SHA-256 engine (sha2_mb.h). Lane i produces exactly what the scalar
+ * function produces for the i-th inputs, and out[i] may alias any input of lane i.
+ * All messages of one hash32_x call have the same length inlen.
+ */
+void hash32_x(const unsigned char *const in[], unsigned int inlen, unsigned char *const out[], unsigned int n);
+void prg_x(const unsigned char *const seed[], const uint64_t input[], unsigned char *const output[], unsigned int n);
+void prg32_x(const unsigned char *const key[], const unsigned char *const input[], unsigned char *const output[], unsigned int n);
+
+/**
+ * Advance n hash chains of the same length in lockstep: chain[i] = F^steps(chain[i]) with F(k) = prg32(k, input),
+ * which is the WOTS chaining function applied to every lane. Each step costs three multi-buffer passes,
+ * the two HMAC key blocks of a lane sharing the first one.
+ */
+void prg32_chain_x(unsigned char *const chain[], const unsigned char input[32], unsigned int steps, unsigned int n);
+
+/**
+ * prg32_chain_x with a length per chain: chain[i] = F^steps[i](chain[i]), as needed by WOTS signing and
+ * verification where the lengths follow the message chunks. The chains are taken longest first and a lane
+ * is handed the next chain as soon as its own one ends, so the vector stays full until the last few steps.
+ */
+void prg32_chains_x(unsigned char *const chain[], const unsigned char input[32], const unsigned int steps[], unsigned int n);
+
 
 #endif // __HASH_H
@@ -18,12 +18,22 @@
 #ifndef __MSS_H
 #define __MSS_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "winternitz.h"
 
 #define MSS_OK 1
 #define MSS_ERROR 0
 
+/**
+ * Node hash of a key pair, chosen at key generation: SHA-256 (hash32_fixed32/64), or AES-MMO, where a
+ * node value is the LEN_BYTES(MSS_SEC_LVL)-byte tag of MMO_hash32 (zero padded to NODE_VALUE_SIZE),
+ * for hosts where AES-NI is faster than SHA-256.
+ */
+#define MSS_HASH_SHA256 0
+#define MSS_HASH_MMO    1
+
 #ifndef MSS_HEIGHT
 #define MSS_HEIGHT 10
 #endif
@@ -41,6 +51,10 @@
 
 #define MSS_RETAIN_SIZE			((1 << MSS_K) - MSS_K - 1)
 
+#ifndef MSS_TREEHASH_AHEAD
+#define MSS_TREEHASH_AHEAD		((MSS_HEIGHT - MSS_K) / 2) // leaves per treehash instance computed ahead under a budget
+#endif
+
 #define NODE_VALUE_SIZE 2*(LEN_BYTES(MSS_SEC_LVL))
 
 struct mss_node {
@@ -49,10 +63,40 @@ struct mss_node {
     unsigned char value[NODE_VALUE_SIZE];   // node's value for auth path
 };
 
+/**
+ * One segment of a message given in pieces, as in struct iovec
+ */
+struct mss_iovec {
+    const void *base;
+    size_t len;
+};
+
+/**
+ * Signer state of the BDS traversal. Each signature runs the (H-K)/2 treehash updates of the BDS schedule, whose
+ * cost depends on the leaf: most compute (H-K)/2 leaves, some none. With a non-zero budget, a signature which
+ * did less work than budget computes the next leaves of the running treehash instances ahead of time (pending),
+ * so that the updates of the following signatures find them ready. The schedule itself is unchanged, so every
+ * node is still ready in time whatever the budget; a budget slightly above the average work flattens the peaks.
+ *
+ * Treehash h finds the WOTS seeds of its leaves on two fsgen checkpoints: ladder[h] follows its own leaves, and
+ * rung[h] moves one leaf per signature so as to stay 3*2^h leaves ahead of the signer, where treehash h restarts.
+ * A restart copies the rung into the ladder, so no signature walks more than one fsgen per height to reach a
+ * seed. Checkpoints that fall to the next leaf or behind are wiped, as they would give the seeds of used leaves.
+ */
 struct mss_state {
+    unsigned char hash_mode;                // MSS_HASH_*, fixed by mss_keygen_core
     unsigned char treehash_state[MSS_TREEHASH_SIZE];
     uint64_t stack_index, retain_index[MSS_K-1];
     uint64_t treehash_seed[MSS_TREEHASH_SIZE]; //treehash_seed: index of the seed for the treehash of height h
+    uint64_t ladder_index[MSS_TREEHASH_SIZE];   // the next fsgen of ladder[h] gives the WOTS seed of leaf ladder_index[h], UINT64_MAX if unset
+    unsigned char ladder[MSS_TREEHASH_SIZE][LEN_BYTES(WINTERNITZ_N)]; // forward secure seed checkpoint kept by treehash h
+    uint64_t rung_index[MSS_TREEHASH_SIZE];     // leaf 3*2^h after the next one to sign, UINT64_MAX past the last leaf
+    unsigned char rung[MSS_TREEHASH_SIZE][LEN_BYTES(WINTERNITZ_N)]; // the next fsgen of rung[h] gives the WOTS seed of leaf rung_index[h]
+    uint64_t budget;                        // treehash work per signature, in MSS_COST_* units, 0 for the BDS schedule
+    uint64_t work;                          // MSS_COST_* units spent by the last traversal step, not serialized
+    uint64_t ahead[MSS_TREEHASH_SIZE];      // leaves treehash_seed[h] to ahead[h]-1 of treehash h are in pending, not serialized
+    struct mss_node pending[MSS_TREEHASH_SIZE][MSS_TREEHASH_AHEAD]; // leaf i at i % MSS_TREEHASH_AHEAD
+    const unsigned char (*leaves)[NODE_VALUE_SIZE]; // all the leaves, only while mss_keygen_core_shards replays the traversal
     struct mss_node treehash[MSS_TREEHASH_SIZE];
 #if MSS_STACK_SIZE != 0    
     struct mss_node stack[MSS_STACK_SIZE];
@@ -63,14 +107,46 @@ struct mss_state {
     struct mss_node store[MSS_TREEHASH_SIZE-1];
 };
 
+/**
+ * The message independent part of the signature of one leaf, computed ahead of time by mss_presign_leaf
+ * (see presign.h): the WOTS private seed, the leaf Hash(v) and, when enabled, the keygen chain checkpoints.
+ */
+struct mss_presigned {
+    uint64_t index;                         // leaf index
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned char leaf[NODE_VALUE_SIZE];
+#if WINTERNITZ_CACHE_SPACING
+    winternitz_cache_t cache;
+#endif
+};
+
+/**
+ * Work accounting of the traversal step (_nextAuth), in SHA-256 compression calls; an AES-MMO node hash counts
+ * as one. These are the estimates the budgeted treehash scheduler charges, reported in mss_state.work.
+ */
+#define MSS_COST_FSGEN      6 // two HMAC key pads, then two one-block evaluations
+#define MSS_COST_PARENT     2
+#if WINTERNITZ_PRG_SECRETS
+#define MSS_COST_SECRETS    (2 + 2 * WINTERNITZ_L)
+#else
+#define MSS_COST_SECRETS    (MSS_COST_FSGEN * WINTERNITZ_L)
+#endif
+#define MSS_COST_LEAF       (MSS_COST_SECRETS + 4 * WINTERNITZ_L * WINTERNITZ_CHAIN_LEN + (WINTERNITZ_L * LEN_BYTES(WINTERNITZ_N) + 8) / HASH_BLOCKSIZE + 2)
+
 #define MSS_NODE_SIZE	(9 + NODE_VALUE_SIZE)
-#define MSS_STATE_SIZE	(2 + (MSS_TREEHASH_SIZE + 2 * (MSS_K + MSS_TREEHASH_SIZE) + MSS_NODE_SIZE * (MSS_TREEHASH_SIZE + MSS_STACK_SIZE + MSS_RETAIN_SIZE + MSS_KEEP_SIZE + MSS_HEIGHT + MSS_TREEHASH_SIZE - 1)))
-#define MSS_SKEY_SIZE	(MSS_STATE_SIZE + LEN_BYTES(MSS_SEC_LVL))
-#define MSS_PKEY_SIZE	NODE_VALUE_SIZE
+#define MSS_STATE_SIZE	(3 + (MSS_TREEHASH_SIZE + 2 * (MSS_K + MSS_TREEHASH_SIZE) + 2 * MSS_TREEHASH_SIZE * (8 + LEN_BYTES(WINTERNITZ_N)) + 8 + MSS_NODE_SIZE * (MSS_TREEHASH_SIZE + MSS_STACK_SIZE + MSS_RETAIN_SIZE + MSS_KEEP_SIZE + MSS_HEIGHT + MSS_TREEHASH_SIZE - 1)))
+#define MSS_SKEY_SIZE	(MSS_STATE_SIZE + LEN_BYTES(WINTERNITZ_N))
+#define MSS_PKEY_SIZE	(NODE_VALUE_SIZE + 1) // root || hash mode
 #define MSS_OTS_SIZE    WINTERNITZ_SIG_SIZE
-#define MSS_SIGNATURE_SIZE (MSS_NODE_SIZE + MSS_HEIGHT * MSS_NODE_SIZE + MSS_OTS_SIZE)
+#define MSS_RANDOMIZER_SIZE 4 // the counter appended to the message by mss_sign_core_grind
+#define MSS_SIGNATURE_SIZE (MSS_NODE_SIZE + MSS_HEIGHT * MSS_NODE_SIZE + MSS_OTS_SIZE + MSS_RANDOMIZER_SIZE)
+
+#ifndef MSS_GRIND_ATTEMPTS
+#define MSS_GRIND_ATTEMPTS 1 // randomizers tried by mss_sign, 1 for no grinding
+#endif
 
-unsigned char *mss_keygen(const unsigned char seed[LEN_BYTES(MSS_SEC_LVL)]);
+unsigned char *mss_keygen(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)]);
+unsigned char *mss_keygen_mode(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], unsigned char hash_mode);
 unsigned char *mss_sign(unsigned char skey[MSS_SKEY_SIZE], const unsigned char digest[NODE_VALUE_SIZE], const unsigned char *pkey);
 unsigned char mss_verify(const unsigned char signature[MSS_SIGNATURE_SIZE], const unsigned char pkey[MSS_PKEY_SIZE], const unsigned char digest[NODE_VALUE_SIZE]);
 
@@ -80,16 +156,189 @@ void deserialize_mss_node(struct mss_node *node, const unsigned char buffer[]);
 void serialize_mss_state(struct mss_state state, uint64_t index, unsigned char buffer[MSS_STATE_SIZE]);
 void deserialize_mss_state(struct mss_state *state, uint64_t *index, const unsigned char buffer[]);
 
-void serialize_mss_skey(struct mss_state state, uint64_t index, const unsigned char skey[LEN_BYTES(MSS_SEC_LVL)], unsigned char buffer[MSS_SKEY_SIZE]);
-void deserialize_mss_skey(struct mss_state *state, uint64_t *index, unsigned char skey[LEN_BYTES(MSS_SEC_LVL)], const unsigned char buffer[]);
+void serialize_mss_skey(struct mss_state state, uint64_t index, const unsigned char skey[LEN_BYTES(WINTERNITZ_N)], unsigned char buffer[MSS_SKEY_SIZE]);
+void deserialize_mss_skey(struct mss_state *state, uint64_t *index, unsigned char skey[LEN_BYTES(WINTERNITZ_N)], const unsigned char buffer[]);
+
+/**
+ * Push-style mss_verify, for a signature received in pieces: mss_verify_stream_init, then mss_verify_stream_update
+ * with the signature bytes in order and in pieces of any size, and mss_verify_stream_final gives the result.
+ * The fields are used as they complete: the message hash once v and the randomizer are in, each WOTS chain as
+ * soon as its block is (see winternitz_verify_update), and each authentication node as it arrives, so neither
+ * the OTS nor the authentication path is kept. pkey and digest must stay valid until mss_verify_stream_final.
+ *
+ * mss_verify_stream_update returns MSS_ERROR once the signature is known to be malformed or too long, in which
+ * case the remaining bytes need not be sent; mss_verify_stream_final returns MSS_OK only for a complete and
+ * valid signature, and wipes the context.
+ */
+struct mss_verify_stream {
+    const unsigned char *pkey;
+    const unsigned char *digest;
+    size_t pos;                             // signature bytes received so far
+    unsigned char buf[MSS_NODE_SIZE];       // the field being received, other than the OTS
+    size_t buf_len;
+    struct mss_node node;                   // v, then the node being climbed from the leaf to the root
+    winternitz_stream_t ots;
+    unsigned char status;
+};
+
+void mss_verify_stream_init(struct mss_verify_stream *vs, const unsigned char pkey[MSS_PKEY_SIZE], const unsigned char digest[NODE_VALUE_SIZE]);
+unsigned char mss_verify_stream_update(struct mss_verify_stream *vs, const unsigned char *data, size_t len);
+unsigned char mss_verify_stream_final(struct mss_verify_stream *vs);
+
+void serialize_mss_signature(const unsigned char ots[MSS_OTS_SIZE], const struct mss_node v, const struct mss_node authpath[MSS_HEIGHT], const unsigned char randomizer[MSS_RANDOMIZER_SIZE], unsigned char buffer[MSS_SIGNATURE_SIZE]);
+void deserialize_mss_signature(unsigned char ots[MSS_OTS_SIZE], struct mss_node *v, struct mss_node authpath[MSS_HEIGHT], unsigned char randomizer[MSS_RANDOMIZER_SIZE], const unsigned char signature[]);
+
+
+/**
+ * Parallel mss_keygen_core: the tree is split into 2^t subtrees of height MSS_HEIGHT-t, built by threads threads
+ * (the caller included), and their roots are combined into the top levels on the calling thread. pkey, state and
+ * node1 are the same as with mss_keygen_core, bit for bit.
+ *
+ * @param t         1..min(MSS_HEIGHT-1, MSS_KEYGEN_MAX_LOG_SUBTREES); more subtrees than threads evens out the load
+ * @param threads   1..MSS_KEYGEN_MAX_THREADS
+ * @return MSS_OK, or MSS_ERROR if a parameter is out of range or the subtrees could not be allocated
+ */
+#define MSS_KEYGEN_MAX_THREADS 64
+#define MSS_KEYGEN_MAX_LOG_SUBTREES 16
+unsigned char mss_keygen_core_mt(mmo_t *hash1, mmo_t *hash2, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], struct mss_node *node1, struct mss_node *node2, struct mss_state *state, unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode, unsigned int t, unsigned int threads);
+
+/**
+ * One of the 2^t disjoint leaf ranges a key is split into by mss_keygen_core_shards: the BDS state and forward
+ * secure seed of its first leaf, so that each range signs on its own thread under the same public key. The
+ * range is signed as with a whole key, i.e. fsgen(si, si, ri) then mss_sign_core_* on state for leaf index,
+ * while index < end; the step after its last leaf is wasted work, nothing else is shared between shards.
+ *
+ * The ranges are not cryptographically separated. All leaves hang off one fsgen chain, so si, and the rungs in
+ * state, also give the WOTS seeds of every later range. A shard is as sensitive as the whole key from its first
+ * leaf on, and must be protected and destroyed like one. Only the earlier ranges stay out of its reach.
+ */
+struct mss_shard {
+    struct mss_state state;
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)]; // the next fsgen gives the WOTS seed of leaf index
+    uint64_t index;                         // next leaf of the range
+    uint64_t end;                           // one past its last leaf
+};
+
+/**
+ * mss_keygen_core_mt which also fills shard[0..2^t-1] with the ranges of 2^(MSS_HEIGHT-t) leaves, the subtrees
+ * it builds. Key generation records every leaf, then replays the traversal over the whole tree with them, which
+ * only costs the node hashes, keeping the state at the first leaf of each range: each shard state is the one
+ * the serial signer would have there. Needs 2^MSS_HEIGHT * NODE_VALUE_SIZE bytes of heap meanwhile.
+ * The replay has no seeds, so the ladders of the treehash instances running at a range's first leaf are unset:
+ * the first leaf each of them computes walks from si instead, once per shard.
+ *
+ * @return MSS_OK, or MSS_ERROR as mss_keygen_core_mt or if the leaves could not be allocated
+ */
+unsigned char mss_keygen_core_shards(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], struct mss_shard *shard, unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode, unsigned int t, unsigned int threads);
 
-void serialize_mss_signature(const unsigned char ots[MSS_OTS_SIZE], const struct mss_node v, const struct mss_node authpath[MSS_HEIGHT], char unsigned buffer[MSS_SIGNATURE_SIZE]);
-void deserialize_mss_signature(unsigned char ots[MSS_OTS_SIZE], struct mss_node *v, struct mss_node authpath[MSS_HEIGHT], const unsigned char signature[]);
+void mss_keygen_core(mmo_t *hash1, mmo_t *hash2, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], struct mss_node *node1, struct mss_node *node2, struct mss_state *state, unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode);
+void mss_sign_core(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, const char *msg, size_t len, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, struct mss_node *node1, struct mss_node *node2, unsigned char *ots, struct mss_node authpath[MSS_HEIGHT]);
+unsigned char mss_verify_core(struct mss_node authpath[MSS_HEIGHT], const char *msg, size_t len, unsigned char *h, uint64_t leaf_index, const unsigned char *ots, unsigned char *x, struct mss_node *current_leaf, const unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode);
+
+/**
+ * Same as mss_sign_core and mss_verify_core, for a message given as the concatenation of iovcnt segments.
+ * The segments are hashed in place, so they need not be copied into one buffer first.
+ */
+void mss_sign_core_iov(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, struct mss_node *node1, struct mss_node *node2, unsigned char *ots, struct mss_node authpath[MSS_HEIGHT]);
+unsigned char mss_verify_core_iov(struct mss_node authpath[MSS_HEIGHT], const struct mss_iovec *iov, unsigned int iovcnt, unsigned char *h, uint64_t leaf_index, const unsigned char *ots, unsigned char *x, struct mss_node *current_leaf, const unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode);
 
+/**
+ * mss_sign_core_iov with grinding: the signed message is the iovcnt segments followed by a MSS_RANDOMIZER_SIZE-byte
+ * counter, chosen among the first attempts ones so that the verifier has the fewest chain steps to do
+ * (winternitz_verify_cost). The counter is returned in randomizer, and the signature verifies with
+ * mss_verify_core_iov on the same segments plus the segment { randomizer, MSS_RANDOMIZER_SIZE }.
+ */
+void mss_sign_core_grind(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, struct mss_node *node1, struct mss_node *node2, unsigned char *ots, struct mss_node authpath[MSS_HEIGHT], unsigned int attempts, unsigned char randomizer[MSS_RANDOMIZER_SIZE]);
+
+/**
+ * Deferred traversal: mss_sign_core_deferred returns as soon as the OTS and the authentication path are out, and
+ * leaves the traversal step which prepares the state for the next leaf (_nextAuth) pending. With background set,
+ * a worker thread runs it right away; otherwise the caller runs it with mss_deferred_drain, e.g. when idle.
+ * The next mss_sign_core_deferred waits for or runs a step still pending, so signatures are always the ones of
+ * mss_sign_core. The state belongs to the context from mss_deferred_start to mss_deferred_stop, which drains it.
+ */
+struct mss_deferred {
+    struct mss_state *state;
+    struct mss_node leaf;                   // the signed leaf, read by the step
+    unsigned char seed[LEN_BYTES(WINTERNITZ_N)]; // si at signing time, read by the step
+    uint64_t leaf_index;
+    mmo_t hash;
+    struct mss_node node1, node2;           // step scratch
+    int background, pending, stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+unsigned char mss_deferred_start(struct mss_deferred *d, struct mss_state *state, int background);
+void mss_deferred_drain(struct mss_deferred *d);
+void mss_deferred_stop(struct mss_deferred *d);
+
+/**
+ * mss_sign_core_iov on d->state, with the traversal step deferred as described above. si is only read.
+ */
+void mss_sign_core_deferred(struct mss_deferred *d, const unsigned char *si, const unsigned char *ri, struct mss_node *leaf, const struct mss_iovec *iov, unsigned int iovcnt, unsigned char *h, uint64_t leaf_index, unsigned char *sig, struct mss_node authpath[MSS_HEIGHT]);
 
-void mss_keygen_core(mmo_t *hash1, mmo_t *hash2, const unsigned char seed[LEN_BYTES(MSS_SEC_LVL)], struct mss_node *node1, struct mss_node *node2, struct mss_state *state, unsigned char pkey[NODE_VALUE_SIZE]);
-void mss_sign_core(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, const char *msg, unsigned short len, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, struct mss_node *node1, struct mss_node *node2, unsigned char *ots, struct mss_node authpath[MSS_HEIGHT]);
-unsigned char mss_verify_core(struct mss_node authpath[MSS_HEIGHT], const char *msg, unsigned short len, unsigned char *h, uint64_t leaf_index, const unsigned char *ots, unsigned char *x, struct mss_node *current_leaf, const unsigned char pkey[NODE_VALUE_SIZE]);
+/**
+ * Fill pre for leaf_index of a key pair with the given hash mode, ri being that leaf's WOTS private seed.
+ */
+void mss_presign_leaf(unsigned char hash_mode, uint64_t leaf_index, const unsigned char ri[LEN_BYTES(WINTERNITZ_N)], struct mss_presigned *pre);
+
+/**
+ * mss_sign_core_iov for leaf pre->index, whose leaf and WOTS chains come from pre: only the message hash,
+ * the chain steps that depend on it and the authentication path update are left.
+ */
+void mss_sign_core_presigned(struct mss_state *state, unsigned char *si, const struct mss_presigned *pre, struct mss_node *leaf, const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, struct mss_node *node1, struct mss_node *node2, unsigned char *ots, struct mss_node authpath[MSS_HEIGHT]);
+
+/**
+ * Hypertree: MSS_LAYERS layers of MSS trees of height MSS_HEIGHT, for 2^(MSS_LAYERS * MSS_HEIGHT) signatures.
+ * The trees of layer 0 sign the messages, and each tree of layer l+1 signs the roots of 2^MSS_HEIGHT trees of
+ * layer l with its leaves; the root of the single tree of the top layer is the public key. Key generation
+ * builds the first tree of each layer, MSS_LAYERS trees whatever the capacity. Below the top layer, the next
+ * tree of a layer is built while the current one is in use, one leaf each time the layer below moves to its
+ * next tree (each signature for layer 0), with the walk of mss_keygen_core. When the current tree is used up
+ * the next one takes over, so no signature pays for a whole tree.
+ *
+ * The trees of layer l take their seeds in turn from a forward secure chain started at prg(seed, l):
+ * (chain', seed of tree t) = fsgen(chain). The master seed is not kept, and within a tree the WOTS seeds are
+ * forward secure as with mss_sign_core, so the structure only holds the seeds of leaves and trees to come.
+ *
+ * A signature is the leaf index (8 bytes, little endian) followed by the MSS_SIGNATURE_SIZE-byte signature of
+ * each layer, from layer 0 (on the message) up to the top layer, each in the format of mss_verify.
+ * The structure holds no pointer and is large (MSS_LAYERS BDS states); it belongs to the caller.
+ */
+#ifndef MSS_LAYERS
+#define MSS_LAYERS 2
+#endif
+#if MSS_LAYERS < 1 || MSS_LAYERS * MSS_HEIGHT > 64
+#error MSS_LAYERS * MSS_HEIGHT must be in 1..64
+#endif
+#define MSS_HT_SIGNATURE_SIZE (8 + MSS_LAYERS * MSS_SIGNATURE_SIZE)
+
+struct mss_hypertree {
+    struct mss_state state[MSS_LAYERS];     // the current tree of each layer
+    unsigned char si[MSS_LAYERS][LEN_BYTES(WINTERNITZ_N)]; // the next fsgen gives the WOTS seed of the next leaf of each tree
+    struct mss_node authpath[MSS_LAYERS][MSS_HEIGHT]; // the last path of each tree: a right leaf is read from authpath[0]
+    unsigned char sig[MSS_LAYERS][MSS_SIGNATURE_SIZE]; // sig[l], l >= 1: the root of the current tree of layer l-1 signed by layer l
+    unsigned char chain[MSS_LAYERS][LEN_BYTES(WINTERNITZ_N)]; // the next fsgen gives the seed of the tree after next[l]
+    // next[l], l < MSS_LAYERS - 1: the next tree of layer l, built one leaf at a time
+    struct mss_state next[MSS_LAYERS];
+    unsigned char next_seed[MSS_LAYERS][LEN_BYTES(WINTERNITZ_N)]; // its seed, which becomes si[l]
+    unsigned char next_si[MSS_LAYERS][LEN_BYTES(WINTERNITZ_N)]; // the next fsgen gives the WOTS seed of leaf next_leaf[l]
+    uint64_t next_leaf[MSS_LAYERS];         // leaves of next[l] done
+    uint64_t next_keep[MSS_LAYERS];         // depth of the keep stack of its walk
+    unsigned char next_root[MSS_LAYERS][NODE_VALUE_SIZE]; // set once all the leaves are done
+    uint64_t index;                         // next leaf of the hypertree
+    unsigned char hash_mode;
+};
+
+void mss_hypertree_keygen(struct mss_hypertree *ht, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], unsigned char pkey[MSS_PKEY_SIZE], unsigned char hash_mode);
+
+/**
+ * Sign digest with the next leaf of ht. Returns MSS_ERROR once all the leaves are used.
+ */
+unsigned char mss_hypertree_sign(struct mss_hypertree *ht, const unsigned char digest[NODE_VALUE_SIZE], unsigned char signature[MSS_HT_SIGNATURE_SIZE]);
+unsigned char mss_hypertree_verify(const unsigned char signature[MSS_HT_SIGNATURE_SIZE], const unsigned char pkey[MSS_PKEY_SIZE], const unsigned char digest[NODE_VALUE_SIZE]);
 
 #ifdef DEBUG
 void print_retain(const struct mss_state *state); // used in test.c
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PARAMS_H
+#define __PARAMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MSS_PARAMS_SEED_SIZE 32 // LEN_BYTES(WINTERNITZ_N), the same for every profile
+
+/**
+ * One MSS parameter set chosen at run time. The sizes of mss.h and winternitz.h are compile-time constants,
+ * so the library is built once more per profile listed in MSS_PROFILES (see the makefile), each copy with its
+ * constants folded into the hot loops, and this descriptor gives its sizes and entry points.
+ *
+ * A signer is an opaque block of signer_size bytes, with the alignment of malloc, which the caller allocates
+ * anywhere (heap, arena) and which holds the BDS state, the next leaf index and the forward secure seed.
+ * Keys and signatures use the serialized formats of mss_sign and mss_verify for the profile's sizes.
+ */
+struct mss_params {
+    const char *name;                       // "H_K_w", e.g. "10_2_2"
+    unsigned int height, k, w;              // MSS_HEIGHT, MSS_K and WINTERNITZ_W
+    size_t signer_size;
+    size_t skey_size;                       // MSS_SKEY_SIZE, a saved signer
+    size_t pkey_size;                       // MSS_PKEY_SIZE
+    size_t signature_size;                  // MSS_SIGNATURE_SIZE
+    size_t digest_size;                     // NODE_VALUE_SIZE, the message digest given to sign and verify
+    size_t ots_size;                        // MSS_OTS_SIZE, a WOTS signature
+
+    /**
+     * mss_keygen_core for the profile: initialize signer for leaf 0 and write the public key (root || hash_mode).
+     */
+    void (*keygen)(const unsigned char seed[MSS_PARAMS_SEED_SIZE], void *signer, unsigned char *pkey, unsigned char hash_mode);
+
+    /**
+     * Sign digest with the next leaf of signer, as mss_sign. Returns MSS_ERROR once all the leaves are used.
+     */
+    unsigned char (*sign)(void *signer, const unsigned char *digest, unsigned char *signature);
+
+    /**
+     * mss_verify for the profile.
+     */
+    unsigned char (*verify)(const unsigned char *signature, const unsigned char *pkey, const unsigned char *digest);
+
+    /**
+     * Serialize a signer to skey_size bytes (serialize_mss_skey), and back.
+     */
+    void (*save)(const void *signer, unsigned char *skey);
+    void (*load)(void *signer, const unsigned char *skey);
+
+    /**
+     * The WOTS layer of the profile, under the public seed of its MSS keys: winternitz_keygen of the one-time
+     * seed s into the public key v, winternitz_sign of the digest h, and winternitz_verify (MSS_OK or MSS_ERROR).
+     */
+    void (*ots_keygen)(const unsigned char s[MSS_PARAMS_SEED_SIZE], unsigned char *v);
+    void (*ots_sign)(const unsigned char s[MSS_PARAMS_SEED_SIZE], const unsigned char *h, unsigned char *sig);
+    unsigned char (*ots_verify)(const unsigned char *v, const unsigned char *h, const unsigned char *sig);
+};
+
+/**
+ * The profiles built into the library, NULL terminated.
+ */
+extern const struct mss_params *const mss_profiles[];
+
+/**
+ * The profile for (height, k, w), or NULL if it was not built.
+ */
+const struct mss_params *mss_params_find(unsigned int height, unsigned int k, unsigned int w);
+
+#endif // __PARAMS_H
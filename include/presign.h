@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PRESIGN_H
+#define __PRESIGN_H
+
+#include <pthread.h>
+#include "mss.h"
+
+#define PRESIGN_IDLE_NS 50000 // producer sleep while the ring is full
+
+/**
+ * Pre-signing pipeline: a producer thread runs ahead of the signer and fills a single-producer/single-consumer
+ * ring with the struct mss_presigned of the next leaves, so that a signature only does the message dependent work.
+ * head and tail count the slots consumed and produced, and are only accessed atomically.
+ */
+struct mss_presign {
+    struct mss_presigned *slot;
+    unsigned int depth;                     // number of slots
+    unsigned int cpu_budget;                // percentage of one core the producer may use, 1..100
+    uint64_t head, tail;                    // slot[head % depth] is the oldest one, slot[tail % depth] the next to fill
+    uint64_t wanted;                        // lowest leaf the signer may still ask for, set by mss_presign_get
+    uint64_t next, end;                     // producer: next leaf to compute, and one past the last leaf
+    unsigned char seed[LEN_BYTES(WINTERNITZ_N)]; // producer: forward secure seed, the next fsgen gives the WOTS seed of leaf next
+    unsigned char hash_mode;
+    int stop;
+    pthread_t thread;
+};
+
+/**
+ * Start the producer at leaf_index.
+ *
+ * @param ring          the pipeline, owned by the caller until mss_presign_stop
+ * @param seed          the signer seed from which the next fsgen derives the WOTS seed of leaf_index,
+ *                      i.e. si before the fsgen(si, si, ri) of that leaf
+ * @param leaf_index    the first leaf to precompute
+ * @param hash_mode     the MSS_HASH_* mode of the key pair
+ * @param depth         ring size, in leaves
+ * @param cpu_budget    percentage of one core the producer may use (100: no throttling)
+ * @return MSS_OK, or MSS_ERROR if the ring could not be allocated or the thread created
+ */
+unsigned char mss_presign_start(struct mss_presign *ring, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], uint64_t leaf_index, unsigned char hash_mode, unsigned int depth, unsigned int cpu_budget);
+
+/**
+ * Stop and join the producer, then wipe and free the ring. Nothing is done for a ring whose mss_presign_start
+ * failed or which is already stopped.
+ */
+void mss_presign_stop(struct mss_presign *ring);
+
+/**
+ * The precomputed values of leaf_index, or NULL if the producer has not reached it yet, in which case the
+ * caller either signs with mss_sign_core as usual or asks again later. Slots of earlier leaves are wiped and
+ * dropped, and the producer skips ahead to leaf_index if it fell behind. A non-NULL slot must be handed back
+ * with mss_presign_release once the signature is done, which wipes it.
+ */
+const struct mss_presigned *mss_presign_get(struct mss_presign *ring, uint64_t leaf_index);
+void mss_presign_release(struct mss_presign *ring);
+
+/**
+ * Number of filled slots, for monitoring.
+ */
+unsigned int mss_presign_occupancy(const struct mss_presign *ring);
+
+#endif // __PRESIGN_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHA2_MB_H
+#define __SHA2_MB_H
+
+#include "sph_types.h"
+#include "cpu.h"
+
+#define SHA256_MB_LANES_AVX2    8
+#define SHA256_MB_LANES_AVX512  16
+#define SHA256_MB_MAX_LANES     SHA256_MB_LANES_AVX512
+
+extern const sph_u32 sha256_K[64]; // SHA-256 round constants, shared by the accelerated backends
+
+/**
+ * Multi-buffer SHA-256 compression: apply the compression function to n independent
+ * states in lockstep, each one absorbing its own 64-byte block.
+ * This runs the engine installed by the dispatch layer (dispatch.h), one of the functions below.
+ *
+ * @param val       n chaining values, updated in place
+ * @param block     n pointers to 64-byte message blocks (no alignment required)
+ * @param n         number of lanes, any value
+ */
+void sha256_mb_comp(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+
+/**
+ * The multi-buffer engines, with the same interface as sha256_mb_comp. The _ref engine sends every lane
+ * through sph_sha256_comp. The _ni engine pairs lanes through the interleaved SHA extensions kernel
+ * (sha2_ni.h). The _avx2 and _avx512 engines pack 8 or 16 lanes into vectors and send a small remainder
+ * to the _ref engine, or up to half a group of lanes to the _ni engine for _avx512_ni.
+ * The accelerated engines must only be called when cpu_features() reports the instruction sets they use.
+ */
+void sha256_mb_comp_ref(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+#ifdef CPU_X86
+void sha256_mb_comp_ni(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+void sha256_mb_comp_avx2(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+void sha256_mb_comp_avx512(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+void sha256_mb_comp_avx512_ni(sph_u32 val[][8], const unsigned char *const block[], unsigned int n);
+#endif
+
+/**
+ * Number of lanes processed by one pass of sha256_mb_comp with the installed engine (1 if not accelerated).
+ * Callers batching their own work should feed multiples of this value.
+ */
+unsigned int sha256_mb_lanes(void);
+
+#endif // __SHA2_MB_H
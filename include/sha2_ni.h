@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHA2_NI_H
+#define __SHA2_NI_H
+
+#include "sph_types.h"
+#include "cpu.h"
+
+#ifdef CPU_X86
+
+/**
+ * SHA-256 compression with the Intel SHA extensions. Only call when cpu_features() reports CPU_SHANI.
+ *
+ * @param data      one 64-byte message block (no alignment required)
+ * @param val       the chaining value, updated in place
+ */
+void sha256_ni_comp(const unsigned char *data, sph_u32 val[8]);
+
+/**
+ * Two independent compressions with their rounds interleaved, so that the latency of one
+ * sha256rnds2 chain is hidden behind the other. Same requirements as sha256_ni_comp.
+ */
+void sha256_ni_comp_x2(const unsigned char *data0, sph_u32 val0[8], const unsigned char *data1, sph_u32 val1[8]);
+
+#endif // CPU_X86
+
+#endif // __SHA2_NI_H
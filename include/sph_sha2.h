@@ -190,6 +190,33 @@ void sph_sha256_close(void *cc, void *dst);
  */
 void sph_sha256_addbits_and_close(void *cc, unsigned ub, unsigned n, void *dst);
 
+/**
+ * Copy a running SHA-224 computation from <code>src</code> into
+ * <code>dst</code>. Only the chaining value, the byte count and the
+ * pending (not yet compressed) bytes are copied, so cloning a context
+ * which sits on a block boundary is cheap. This is used both to save a
+ * midstate (e.g. after a fixed key block) and to restore it later.
+ *
+ * @param dst   the destination context
+ * @param src   the source context
+ */
+void sph_sha224_clone(void *dst, const void *src);
+
+#ifdef DOXYGEN_IGNORE
+/**
+ * Clone a running SHA-256 computation. This function is identical to
+ * <code>sph_sha224_clone()</code>.
+ *
+ * @param dst   the destination context
+ * @param src   the source context
+ */
+void sph_sha256_clone(void *dst, const void *src);
+#endif
+
+#ifndef DOXYGEN_IGNORE
+#define sph_sha256_clone   sph_sha224_clone
+#endif
+
 #ifdef DOXYGEN_IGNORE
 /**
  * Apply the SHA-256 compression function on the provided data. This
@@ -205,6 +232,45 @@ void sph_sha256_comp(const sph_u32 msg[16], sph_u32 val[8]);
 #define sph_sha256_comp   sph_sha224_comp
 #endif
 
+/**
+ * Apply the portable SHA-256 compression function to a 64-byte block
+ * given as bytes (no alignment required). This is the fallback installed
+ * by the dispatch layer when no accelerated backend is available.
+ *
+ * @param data   the message block (64 bytes)
+ * @param val    the function 256-bit input and output
+ */
+void sph_sha256_comp_block(const unsigned char *data, sph_u32 val[8]);
+
+/**
+ * Hash the last 32 bytes of a SHA-256 message whose first
+ * <code>prelen</code> bytes (a multiple of 64) have already been
+ * compressed into the chaining value <code>iv</code>. The final block
+ * (data, padding and length) is built directly as message words, without
+ * going through the context buffer. With the standard IV and
+ * <code>prelen</code> = 0 this is SHA-256 of a 32-byte input; with an
+ * HMAC key midstate and <code>prelen</code> = 64 it finishes an HMAC
+ * over a 32-byte message or inner digest.
+ *
+ * @param iv       the chaining value to start from (not modified)
+ * @param prelen   the number of bytes already compressed into iv
+ * @param data     the 32 input bytes
+ * @param dst      the 32-byte output
+ */
+void sph_sha256_fixed32(const sph_u32 iv[8], sph_u32 prelen,
+	const void *data, void *dst);
+
+/**
+ * SHA-256 of the 64-byte message <code>left || right</code>, each half
+ * being 32 bytes. The second (padding only) block is a constant, so its
+ * message schedule is precomputed and only its 64 rounds are run.
+ *
+ * @param left    the first 32 input bytes
+ * @param right   the last 32 input bytes
+ * @param dst     the 32-byte output
+ */
+void sph_sha256_fixed64(const void *left, const void *right, void *dst);
+
 #if SPH_64
 
 /**
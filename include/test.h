@@ -20,9 +20,28 @@
 
 enum TEST {
 	TEST_MSS_SIGN,
+	TEST_MSS_SIGN_MMO,
+	TEST_MSS_PRESIGN,
+	TEST_MSS_GRIND,
+	TEST_MSS_KEYGEN_MT,
+	TEST_MSS_DEFERRED,
+	TEST_MSS_BUDGET,
+	TEST_MSS_LADDER,
+	TEST_MSS_SHARDS,
 	TEST_AES_ENC,
+	TEST_SHA256,
+	TEST_HASH_BATCH,
+	TEST_DISPATCH,
+	TEST_ETCR,
+	TEST_WINTERNITZ_CHUNKS,
+	TEST_WINTERNITZ_CACHE,
+	TEST_WINTERNITZ_RANGES,
+	TEST_WINTERNITZ_POOL,
 #ifdef SERIALIZATION
-	TEST_MSS_SERIALIZATION
+	TEST_MSS_SERIALIZATION,
+	TEST_MSS_STREAM,
+	TEST_MSS_PROFILES,
+	TEST_MSS_HYPERTREE
 #endif
 };
 
@@ -27,22 +27,24 @@
 #define WINTERNITZ_SEC_LVL	128
 #define WINTERNITZ_N 		256
 
-#if WINTERNITZ_W > 8
-#error maximum value for w is 8 due to chosen data type in this implementation
+#if WINTERNITZ_W < 1 || WINTERNITZ_W > 16
+#error w must be in 1..16, chunks and checksum are handled as 32-bit words
 #endif
 
-#define WINTERNITZ_l1 ((WINTERNITZ_N + WINTERNITZ_W - 1) / WINTERNITZ_W)
-#if (WINTERNITZ_W == 2)
-    #if WINTERNITZ_N == 128
-		#define WINTERNITZ_l2 (4)
-    #elif WINTERNITZ_N == 256
-    	#define WINTERNITZ_l2 (5)
-    #endif
-#elif (WINTERNITZ_W == 4)
-    #define WINTERNITZ_l2 (3) //l2=3 if l1 \in {32,64}
-#elif (WINTERNITZ_W == 8)
-    #define WINTERNITZ_l2 (2)
-#endif
+// floor(lg(x)) for 0 < x < 2^32, usable in constant expressions
+#define WINTERNITZ_LOG2_2(x)  ((x) >> 1 ? 1 : 0)
+#define WINTERNITZ_LOG2_4(x)  ((x) >> 2 ? 2 + WINTERNITZ_LOG2_2((x) >> 2) : WINTERNITZ_LOG2_2(x))
+#define WINTERNITZ_LOG2_8(x)  ((x) >> 4 ? 4 + WINTERNITZ_LOG2_4((x) >> 4) : WINTERNITZ_LOG2_4(x))
+#define WINTERNITZ_LOG2_16(x) ((x) >> 8 ? 8 + WINTERNITZ_LOG2_8((x) >> 8) : WINTERNITZ_LOG2_8(x))
+#define WINTERNITZ_LOG2(x)    ((x) >> 16 ? 16 + WINTERNITZ_LOG2_16((x) >> 16) : WINTERNITZ_LOG2_16(x))
+
+// Chunk counts for any w: l1 = ceil(N/w) message chunks, l2 = floor(lg(l1*(2^w-1))/w) + 1 checksum chunks
+#define WINTERNITZ_L1(w) ((WINTERNITZ_N + (w) - 1) / (w))
+#define WINTERNITZ_L2(w) (WINTERNITZ_LOG2(WINTERNITZ_L1(w) * ((1UL << (w)) - 1)) / (w) + 1)
+#define WINTERNITZ_MAX_L (WINTERNITZ_L1(1) + WINTERNITZ_L2(1)) // the longest signature, w = 1
+
+#define WINTERNITZ_l1 WINTERNITZ_L1(WINTERNITZ_W)
+#define WINTERNITZ_l2 WINTERNITZ_L2(WINTERNITZ_W)
 #define WINTERNITZ_CHECKSUM_SIZE (WINTERNITZ_l2)
 #define WINTERNITZ_l (WINTERNITZ_l1 + WINTERNITZ_CHECKSUM_SIZE)
 #define WINTERNITZ_L (WINTERNITZ_l1 + WINTERNITZ_CHECKSUM_SIZE)
@@ -52,6 +54,70 @@
 
 #define WINTERNITZ_SIG_SIZE WINTERNITZ_L*LEN_BYTES(WINTERNITZ_N)
 
+/**
+ * Derivation of the private blocks sk_0, ..., sk_{L-1} from the key seed s. By default they come from the forward
+ * secure ladder (s_{i+1}, sk_i) = fsgen(s_i), so sk_i needs the i blocks before it. With WINTERNITZ_PRG_SECRETS
+ * set, sk_i = prg(s, i): any chain can be derived on its own, in any order. The two modes give different keys.
+ */
+#ifndef WINTERNITZ_PRG_SECRETS
+#define WINTERNITZ_PRG_SECRETS 0
+#endif
+
+/**
+ * Chain checkpoints kept by winternitz_keygen_cache for a following winternitz_sign_cache, in at most
+ * WINTERNITZ_CACHE_BUDGET bytes (0 disables the cache). Checkpoint k holds every chain after k*WINTERNITZ_CACHE_SPACING
+ * steps, the first one being the private blocks. The spacing is 2^ceil(w/2), or wider when the budget requires it.
+ */
+#ifndef WINTERNITZ_CACHE_BUDGET
+#define WINTERNITZ_CACHE_BUDGET 32768
+#endif
+
+#define WINTERNITZ_CACHE_POINTS_MAX (WINTERNITZ_CACHE_BUDGET / (WINTERNITZ_L * LEN_BYTES(WINTERNITZ_N)))
+#define WINTERNITZ_CHAIN_LEN ((1UL << WINTERNITZ_W) - 1)
+#if WINTERNITZ_CACHE_POINTS_MAX >= 2
+    #define WINTERNITZ_CACHE_MIN_SPACING ((WINTERNITZ_CHAIN_LEN + WINTERNITZ_CACHE_POINTS_MAX - 2) / (WINTERNITZ_CACHE_POINTS_MAX - 1))
+    #if (1UL << ((WINTERNITZ_W + 1) / 2)) >= WINTERNITZ_CACHE_MIN_SPACING
+        #define WINTERNITZ_CACHE_SPACING (1UL << ((WINTERNITZ_W + 1) / 2))
+    #else
+        #define WINTERNITZ_CACHE_SPACING WINTERNITZ_CACHE_MIN_SPACING
+    #endif
+#elif WINTERNITZ_CACHE_POINTS_MAX == 1
+    #define WINTERNITZ_CACHE_SPACING (WINTERNITZ_CHAIN_LEN + 1) // only the private blocks
+#else
+    #define WINTERNITZ_CACHE_SPACING 0
+#endif
+
+#if WINTERNITZ_CACHE_SPACING
+#define WINTERNITZ_CACHE_POINTS (WINTERNITZ_CHAIN_LEN / WINTERNITZ_CACHE_SPACING + 1)
+
+typedef struct {
+    unsigned char point[WINTERNITZ_CACHE_POINTS][WINTERNITZ_L][LEN_BYTES(WINTERNITZ_N)];
+} winternitz_cache_t;
+#endif
+
+/**
+ * Worker pool for the chains of one operation, see winternitz_pool_start. Operations with fewer than
+ * WINTERNITZ_POOL_MIN_STEPS chain steps in total are not worth waking the workers and run on the caller.
+ */
+#ifndef WINTERNITZ_POOL_MAX
+#define WINTERNITZ_POOL_MAX 8
+#endif
+#ifndef WINTERNITZ_POOL_MIN_STEPS
+#define WINTERNITZ_POOL_MIN_STEPS 256
+#endif
+
+/**
+ * Incremental verification context, see winternitz_verify_init.
+ */
+typedef struct {
+    unsigned char *X;
+    unsigned int chunk[WINTERNITZ_L];               // steps left to complete each chain
+    unsigned char part[LEN_BYTES(WINTERNITZ_N)];    // received bytes of the next signature block
+    unsigned int t;                                 // number of bytes in part
+    unsigned int i;                                 // number of chains completed so far
+    sph_sha256_context ctx;                         // hash of the completed chain ends y_0, ..., y_{i-1}
+} winternitz_stream_t;
+
 /**
  * Compute a Winternitz public key v = H_N(x_{0}^{2^w-1}, x_{1}^{2^w-1}, ..., x_{L-1}^{2^w-1}), with L = ceil(N/w) + ceil(lg((2^w-1)*(N/w))/w), N = 256.
  *
@@ -61,6 +127,24 @@
  */
 void winternitz_keygen(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)]);
 
+/**
+ * Split the N-bit hash h into the WINTERNITZ_L1(w) w-bit message chunks followed by the WINTERNITZ_L2(w)
+ * chunks of the checksum sum(2^w-1 - m_i), for any w in 1..16. Chunks are read from the least significant
+ * bits of each byte of h up, and the checksum is emitted least significant chunk first.
+ * The chain of the i-th signature block is chunk[i] steps long at signing and 2^w-1 - chunk[i] at verification.
+ *
+ * @param h         the N-bit message hash
+ * @param w         the Winternitz parameter
+ * @param chunk     receives WINTERNITZ_L1(w) + WINTERNITZ_L2(w) values (at most WINTERNITZ_MAX_L)
+ */
+void winternitz_chunks(const unsigned char *h, unsigned int w, unsigned int *chunk);
+
+/**
+ * Number of chain steps winternitz_verify takes on the message hash h: the sum of 2^w-1 - chunk[i]
+ * over the message and checksum chunks.
+ */
+unsigned int winternitz_verify_cost(const unsigned char *h);
+
 /**
  * Sign the value under private key s, yielding (x_{0:0}, x_{0:1}, x_{0:2}, x_{0:3}, ..., x_{(N/8-1):0}, x_{(N/8-1):1}, x_{(N/8-1):2}, x_{(N/8-1):3})
  *
@@ -70,7 +154,14 @@ void winternitz_keygen(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned
  * @param h		 buffer containing the message hash to be signed, computed outside as h = H(v,data)
  * @param sig
  */
-void winternitz_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_SEC_LVL)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig);
+void winternitz_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig);
+
+/**
+ * The part of winternitz_sign for chains first, ..., first+count-1, written to their blocks of sig. Disjoint
+ * ranges can be signed in any order or by different threads, winternitz_sign being the range 0, ..., L-1.
+ * With WINTERNITZ_PRG_SECRETS the cost only depends on the range; otherwise the ladder is walked up to first.
+ */
+void winternitz_sign_chains(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned char *h, unsigned char *sig, unsigned int first, unsigned int count);
 
 /**
  * Verify a signature on hash H(v,data)
@@ -81,7 +172,54 @@ void winternitz_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_SEC_LVL)], unsig
  * @param sig       the signature
  * @param y         scratch (should match v at the end)
  */
-unsigned char winternitz_verify(const unsigned char *v, unsigned char *X, unsigned char *h, const unsigned char *sig, unsigned char *y);
+unsigned char winternitz_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *y);
+
+/**
+ * Split the chains of each winternitz_keygen, winternitz_sign and winternitz_verify (and their cache and stream
+ * variants) over threads threads, the caller being one of them and hashing the public key itself. The chains
+ * are dealt so that every thread gets about the same number of steps. The pool is shared by the whole process,
+ * the profiles of params.h included: an operation started while another one holds it runs on its own thread, as
+ * it does before winternitz_pool_start.
+ * winternitz_pool_stop waits for the operation holding the pool, if any, and operations may run meanwhile on other
+ * threads; start and stop must not race with each other.
+ *
+ * @param threads   1..WINTERNITZ_POOL_MAX, 1 meaning no worker
+ * @return WINTERNITZ_OK, or WINTERNITZ_ERROR if threads is out of range, a pool is running or a thread could not be created
+ */
+unsigned char winternitz_pool_start(unsigned int threads);
+void winternitz_pool_stop(void);
+
+/**
+ * chain[i] = F^steps[i](chain[i]) under the public seed X for i < n <= WINTERNITZ_MAX_L, over the pool when it is
+ * running and free, else on the calling thread. It does not depend on WINTERNITZ_W, so every profile uses it.
+ */
+void winternitz_chains(unsigned char *const chain[], const unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned int steps[], unsigned int n);
+
+/**
+ * winternitz_verify over a signature received in pieces of any size: winternitz_verify_init(ws, X, h), then
+ * winternitz_verify_update with the signature bytes in order, and winternitz_verify_final gives the candidate
+ * public key y, to be compared with v. Each chain is completed as soon as its block is in, together with the
+ * other blocks of the same piece, so only a partial block is ever kept.
+ *
+ * winternitz_verify_update returns WINTERNITZ_ERROR if more than WINTERNITZ_SIG_SIZE bytes were given, and
+ * winternitz_verify_final if fewer were.
+ */
+void winternitz_verify_init(winternitz_stream_t *ws, unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned char *h);
+unsigned char winternitz_verify_update(winternitz_stream_t *ws, const unsigned char *sig, size_t len);
+unsigned char winternitz_verify_final(winternitz_stream_t *ws, unsigned char y[LEN_BYTES(WINTERNITZ_N)]);
+
+#if WINTERNITZ_CACHE_SPACING
+/**
+ * winternitz_keygen which also stores the chain checkpoints of s in cache.
+ */
+void winternitz_keygen_cache(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)], winternitz_cache_t *cache);
+
+/**
+ * winternitz_sign for the key whose checkpoints are in cache: each chain resumes from the last checkpoint
+ * before its chunk, at most WINTERNITZ_CACHE_SPACING-1 steps away, instead of starting from the private block.
+ */
+void winternitz_sign_cache(const winternitz_cache_t *cache, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig);
+#endif
 
 
 #endif // __WINTERNITZ_H
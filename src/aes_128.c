@@ -17,6 +17,7 @@
 
 #include "aes_128.h"
 #include "ti_aes.h"
+#include "dispatch.h"
 #include <string.h>
 
 #ifdef DEBUG
@@ -41,16 +42,37 @@ unsigned char IV_MMO16[176] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0
  */
 void aes128_encrypt_keyexpanded(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE]) {//, const unsigned char expandedKey[11*AES_128_KEY_SIZE]) {
 
-    memcpy(ciphertext, plaintext, AES_128_BLOCK_SIZE);
+    dispatch.aes_enc_expanded_x(&ciphertext, &plaintext, IV_MMO16, 1);
+}
+
+void aes128_encrypt_keyexpanded_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], unsigned int n) {
+    dispatch.aes_enc_expanded_x(ciphertext, plaintext, IV_MMO16, n);
+}
+
+/**
+ * The portable aes128_encrypt_keyexpanded_x
+ */
+void aes_128_encrypt_expanded_ti_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char expandedKey[11 * AES_128_KEY_SIZE], unsigned int n) {
+    unsigned int i;
 
-    aes_encr(ciphertext, IV_MMO16); // ti_aes.c
-    //aes_encrypt(ciphertext, IV_MMO16); // TI_aes_128_encr_only.c
+    for (i = 0; i < n; i++) {
+        memmove(ciphertext[i], plaintext[i], AES_128_BLOCK_SIZE);
+        aes_encr(ciphertext[i], (unsigned char *) expandedKey); // ti_aes.c
+        //aes_encrypt(ciphertext[i], expandedKey); // TI_aes_128_encr_only.c
+    }
 }
 
 /**
  * Encrypt a single AES block under a 128-bit key.
  */
 void aes_128_encrypt(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]) {
+    dispatch.aes_enc(ciphertext, plaintext, key);
+}
+
+/**
+ * The portable aes_128_encrypt, installed by the dispatch layer when no accelerated backend is available.
+ */
+void aes_128_encrypt_ti(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]) {
 
     unsigned char local_key[AES_128_KEY_SIZE];
     memcpy(local_key, key, AES_128_KEY_SIZE);
@@ -63,6 +85,20 @@ void aes_128_encrypt(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigne
 #endif //AES_ENC_DEC
 }
 
+void aes_128_encrypt_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n) {
+    dispatch.aes_enc_x(ciphertext, plaintext, key, n);
+}
+
+/**
+ * The portable aes_128_encrypt_x, one block after the other.
+ */
+void aes_128_encrypt_ti_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        aes_128_encrypt_ti(ciphertext[i], plaintext[i], key[i]);
+}
+
 #ifdef AES_ENC_DEC
 
 /**
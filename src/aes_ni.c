@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "aes_ni.h"
+
+#ifdef CPU_X86
+
+#include <immintrin.h>
+
+#define AES_NI_TARGET __attribute__((target("aes,ssse3")))
+
+static const int _ni_rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
+
+/*
+ * One step of the AES-128 key schedule. Instead of aeskeygenassist, which is slow on many cores,
+ * RotWord(w3) is broadcast to all four columns with pshufb and aesenclast applies SubWord and the
+ * round constant: ShiftRows does nothing to a block with equal columns. The prefix XOR of the four
+ * key words takes two shifts.
+ */
+AES_NI_TARGET
+static inline __m128i _ni_next_key(__m128i key, int rcon) {
+    __m128i t = _mm_aesenclast_si128(_mm_shuffle_epi8(key, _mm_set1_epi32(0x0C0F0E0D)), _mm_set1_epi32(rcon));
+
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 8));
+    return _mm_xor_si128(key, t);
+}
+
+AES_NI_TARGET
+void aes_128_encrypt_ni(unsigned char ciphertext[AES_128_BLOCK_SIZE], const unsigned char plaintext[AES_128_BLOCK_SIZE], const unsigned char key[AES_128_KEY_SIZE]) {
+    __m128i k = _mm_loadu_si128((const __m128i *) key);
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *) plaintext), k);
+    int r;
+
+    for (r = 0; r < 9; r++) {
+        k = _ni_next_key(k, _ni_rcon[r]);
+        s = _mm_aesenc_si128(s, k);
+    }
+    k = _ni_next_key(k, _ni_rcon[9]);
+    _mm_storeu_si128((__m128i *) ciphertext, _mm_aesenclast_si128(s, k));
+}
+
+/**
+ * Up to AES_NI_LANES blocks under their own keys, round by round.
+ */
+AES_NI_TARGET
+static void _ni_encrypt_group(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int m) {
+    __m128i s[AES_NI_LANES], k[AES_NI_LANES];
+    unsigned int j;
+    int r;
+
+    for (j = 0; j < m; j++) {
+        k[j] = _mm_loadu_si128((const __m128i *) key[j]);
+        s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *) plaintext[j]), k[j]);
+    }
+
+    for (r = 0; r < 9; r++) {
+        for (j = 0; j < m; j++) {
+            k[j] = _ni_next_key(k[j], _ni_rcon[r]);
+            s[j] = _mm_aesenc_si128(s[j], k[j]);
+        }
+    }
+    for (j = 0; j < m; j++) {
+        k[j] = _ni_next_key(k[j], _ni_rcon[9]);
+        _mm_storeu_si128((__m128i *) ciphertext[j], _mm_aesenclast_si128(s[j], k[j]));
+    }
+}
+
+void aes_128_encrypt_ni_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char *const key[], unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i + AES_NI_LANES <= n; i += AES_NI_LANES)
+        _ni_encrypt_group(&ciphertext[i], &plaintext[i], &key[i], AES_NI_LANES);
+    if (i < n)
+        _ni_encrypt_group(&ciphertext[i], &plaintext[i], &key[i], n - i);
+}
+
+AES_NI_TARGET
+void aes_128_encrypt_expanded_ni_x(unsigned char *const ciphertext[], const unsigned char *const plaintext[], const unsigned char expandedKey[11 * AES_128_KEY_SIZE], unsigned int n) {
+    __m128i rk[11], s[AES_NI_LANES];
+    unsigned int i, j, m, r;
+
+    for (r = 0; r < 11; r++)
+        rk[r] = _mm_loadu_si128((const __m128i *) &expandedKey[r * AES_128_KEY_SIZE]);
+
+    for (i = 0; i < n; i += m) {
+        m = (n - i < AES_NI_LANES) ? n - i : AES_NI_LANES;
+        for (j = 0; j < m; j++)
+            s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *) plaintext[i + j]), rk[0]);
+        for (r = 1; r < 10; r++)
+            for (j = 0; j < m; j++)
+                s[j] = _mm_aesenc_si128(s[j], rk[r]);
+        for (j = 0; j < m; j++)
+            _mm_storeu_si128((__m128i *) ciphertext[i + j], _mm_aesenclast_si128(s[j], rk[10]));
+    }
+}
+
+#endif // CPU_X86
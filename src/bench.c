@@ -16,10 +16,12 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include "bench.h"
 #include "mss.h"
+#include "dispatch.h"
 
 
 #ifdef VERBOSE
@@ -44,7 +46,7 @@ unsigned char h1[HASH_LEN], h2[HASH_LEN];
 unsigned char sig_bench[WINTERNITZ_L*HASH_LEN];
 unsigned char aux[HASH_LEN];
 
-void bench_mss_signature() {
+void bench_mss_signature(unsigned char hash_mode) {
     unsigned long i;
     unsigned char k;
     unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
@@ -60,13 +62,13 @@ void bench_mss_signature() {
     MMO_init(&hash2);
     memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
     
-    printf("\n\nBenchmarking MSS operations. Signature and verification are run %d times.\n", 1 << MSS_HEIGHT);
+    printf("\n\nBenchmarking MSS operations with %s nodes. Signature and verification are run %d times.\n", hash_mode == MSS_HASH_MMO ? "AES-MMO" : "SHA-256", 1 << MSS_HEIGHT);
     
     printf("\nBenchmarking MSS key gen with %d execution(s)...\n", BENCH_KEYGEN);
     
     elapsed = -clock();
     for (k = 0; k < BENCH_KEYGEN; k++)
-        mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test);
+        mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, hash_mode);
     elapsed += clock();
     printf("Elapsed: %.1f ms\n\n", 1000 * (float) elapsed / CLOCKS_PER_SEC / BENCH_KEYGEN);
 
@@ -84,13 +86,56 @@ void bench_mss_signature() {
     printf("Benchmarking MSS verify ...\n");
     elapsed = -clock();
     for (i = 0; i < BENCH_SIGNATURE; i++)
-        mss_verify_core(authpath_bench, (const char *) M[i], MSG_LEN_BENCH, h1, i, sig_bench, aux, &currentLeaf_bench, pkey_test);
+        mss_verify_core(authpath_bench, (const char *) M[i], MSG_LEN_BENCH, h1, i, sig_bench, aux, &currentLeaf_bench, pkey_test, hash_mode);
 
     elapsed += clock();
     printf("Elapsed: %.1f ms\n\n", 1000 * (float) elapsed / CLOCKS_PER_SEC / BENCH_SIGNATURE);
 
 }
 
+static int _work_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Traversal work per signature (mss_state.work) over all the leaves, with the BDS schedule and then with a
+ * budget of the median work, which lets the treehash leaves of the following signatures be computed ahead.
+ */
+void bench_mss_budget() {
+    static struct mss_state initial;
+    static uint64_t work[(unsigned long) 1 << MSS_HEIGHT];
+    unsigned long i;
+    uint64_t budget = 0, sum;
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    const char M[MSG_LEN_BENCH] = "budget benchmark";
+    int run;
+
+    printf("\n\nBenchmarking the traversal work per signature, in SHA-256 compression calls (%d leaves)...\n", 1 << MSS_HEIGHT);
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &initial, pkey_test, MSS_HASH_SHA256);
+
+    for (run = 0; run < 2; run++) {
+        state_bench = initial;
+        state_bench.budget = budget;
+        memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+        for (i = 0, sum = 0; i < BENCH_SIGNATURE; i++) {
+            fsgen(si, si, ri);
+            mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, M, MSG_LEN_BENCH, &hash1, h1, i, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+            work[i] = state_bench.work;
+            sum += work[i];
+        }
+        qsort(work, BENCH_SIGNATURE, sizeof work[0], _work_cmp);
+        if (run == 0)
+            printf("BDS schedule: ");
+        else
+            printf("Budget %llu: ", (unsigned long long) budget);
+        printf("mean %llu, median %llu, p99 %llu, max %llu\n", (unsigned long long) (sum / BENCH_SIGNATURE), (unsigned long long) work[BENCH_SIGNATURE / 2],
+               (unsigned long long) work[BENCH_SIGNATURE - 1 - BENCH_SIGNATURE / 100], (unsigned long long) work[BENCH_SIGNATURE - 1]);
+        budget = work[BENCH_SIGNATURE / 2];
+    }
+}
+
 void bench_hash() {
 
     clock_t elapsed;
@@ -146,7 +191,37 @@ void bench_hash() {
     }
     elapsed += clock();
     printf("Elapsed: %.1f us\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);    
+
+    printf("Benchmarking a fixed 32-byte input, 16-byte output MMO hash, batches of %u ...\n", HASH_MAX_LANES);
+    elapsed = -clock();    
+    for (k = 0; k + HASH_MAX_LANES <= hashbenchs; k += HASH_MAX_LANES) {
+        const unsigned char *in[HASH_MAX_LANES];
+        unsigned char *out[HASH_MAX_LANES];
+        for (int i = 0; i < HASH_MAX_LANES; i++) {
+            in[i] = data[k + i];
+            out[i] = digest[k + i];
+        }
+        MMO_hash32_x(in, in, out, HASH_MAX_LANES);
+    }
+    elapsed += clock();
+    printf("Elapsed: %.1f us per hash\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);     
     
+    printf("Benchmarking the tree node hash, SHA-256 nodes (64-byte input) ...\n");
+    elapsed = -clock();    
+    for (k = 0; k + 1 < hashbenchs; k++) {
+        hash32_fixed64(digest[k], digest[k + 1], digest[k]);
+    }
+    elapsed += clock();
+    printf("Elapsed: %.1f us\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);    
+
+    printf("Benchmarking the tree node hash, AES-MMO nodes (32-byte input) ...\n");
+    elapsed = -clock();    
+    for (k = 0; k + 1 < hashbenchs; k++) {
+        MMO_hash32(&hash1, digest[k], digest[k + 1], digest[k]);
+    }
+    elapsed += clock();
+    printf("Elapsed: %.1f us\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);    
+
     printf("Benchmarking a fixed 32-byte input, 32-byte output SHA256 hash ...\n");
     elapsed = -clock();    
     for (k = 0; k < hashbenchs; k++) {
@@ -155,17 +230,37 @@ void bench_hash() {
     elapsed += clock();
     printf("Elapsed: %.1f us\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);     
     
+    printf("Benchmarking a fixed 32-byte input, 32-byte output SHA256 hash, batches of %u ...\n", HASH_MAX_LANES);
+    elapsed = -clock();    
+    for (k = 0; k + HASH_MAX_LANES <= hashbenchs; k += HASH_MAX_LANES) {
+        const unsigned char *in[HASH_MAX_LANES];
+        unsigned char *out[HASH_MAX_LANES];
+        for (int i = 0; i < HASH_MAX_LANES; i++) {
+            in[i] = data[k + i];
+            out[i] = digest[k + i];
+        }
+        hash32_x(in, 2*MSG_LEN_BENCH, out, HASH_MAX_LANES);
+    }
+    elapsed += clock();
+    printf("Elapsed: %.1f us per hash\n\n", 1000000 * (float) elapsed / CLOCKS_PER_SEC / hashbenchs);     
+    
 }
 
 void do_bench(enum BENCH operation) {
 
     switch (operation) {
         case BENCH_MSS:
-            bench_mss_signature();
+            bench_mss_signature(MSS_HASH_SHA256);
+            break;
+        case BENCH_MSS_MMO:
+            bench_mss_signature(MSS_HASH_MMO);
             break;
         case BENCH_HASH:
             bench_hash();
             break;
+        case BENCH_MSS_BUDGET:
+            bench_mss_budget();
+            break;
         default:
             break;
     }
@@ -175,9 +270,12 @@ void do_bench(enum BENCH operation) {
 int main() {
     
     printf("\nParameters:  WINTERNITZ_N=%u, Tree_Height=%u, Treehash_K=%u, WINTERNITZ_w=%u \n\n", MSS_SEC_LVL, MSS_HEIGHT, MSS_K, WINTERNITZ_W);
+    printf("Backend: %s\n\n", dispatch.name);
     
     do_bench(BENCH_HASH);
     do_bench(BENCH_MSS);    
+    do_bench(BENCH_MSS_MMO);
+    do_bench(BENCH_MSS_BUDGET);
     
     return 0;
 }
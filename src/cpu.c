@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cpu.h"
+
+#ifdef CPU_X86
+#include <cpuid.h>
+
+static unsigned long long _xgetbv(unsigned int index) {
+    unsigned int eax, edx;
+    
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((unsigned long long) edx << 32) | eax;
+}
+
+static unsigned int _cpu_probe(void) {
+    unsigned int eax, ebx, ecx, edx, max_leaf, features = 0;
+    unsigned long long xcr0 = 0;
+    
+    if (!__get_cpuid(0, &max_leaf, &ebx, &ecx, &edx))
+        return 0;
+    
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (ecx & bit_SSE4_1)
+        features |= CPU_SSE41;
+    if ((ecx & bit_AES) && (ecx & bit_SSSE3)) // the AES-NI key schedule uses pshufb
+        features |= CPU_AESNI;
+    if (ecx & bit_OSXSAVE)
+        xcr0 = _xgetbv(0);
+    
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx & bit_SHA) && (features & CPU_SSE41))
+            features |= CPU_SHANI;
+        if ((ebx & bit_AVX2) && (xcr0 & 0x06) == 0x06) // XMM and YMM state enabled by the OS
+            features |= CPU_AVX2;
+        if ((ebx & bit_AVX512F) && (xcr0 & 0xE6) == 0xE6) // plus opmask and ZMM state
+            features |= CPU_AVX512;
+    }
+    
+    return features;
+}
+#endif // CPU_X86
+
+unsigned int cpu_features(void) {
+#ifdef CPU_X86
+    static int probed = 0;
+    static unsigned int features = 0;
+    
+    if (!probed) {
+        features = _cpu_probe();
+        probed = 1;
+    }
+    return features;
+#else
+    return 0;
+#endif
+}
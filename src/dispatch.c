@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dispatch.h"
+#include "sph_sha2.h"
+#include "sha2_ni.h"
+#include "sha2_mb.h"
+#include "hash.h"
+#include "aes_128.h"
+#include "aes_ni.h"
+
+struct dispatch_table dispatch = {
+    0,
+    "ref",
+    sph_sha256_comp_block,
+    sha256_mb_comp_ref,
+    1,
+    prg32_sph,
+    aes_128_encrypt_ti,
+    aes_128_encrypt_ti_x,
+    aes_128_encrypt_expanded_ti_x
+};
+
+static const struct {
+    const char *name;
+    unsigned int features;
+} _backends[] = {
+    {"ref", 0},
+    {"avx2", CPU_AVX2},
+    {"avx512", CPU_AVX512},
+    {"shani", CPU_SSE41 | CPU_SHANI},
+    {"aesni", CPU_AESNI},
+    {"native", ~0u}
+};
+
+void dispatch_select(unsigned int features) {
+    struct dispatch_table t = {0, "", sph_sha256_comp_block, sha256_mb_comp_ref, 1, prg32_sph,
+                               aes_128_encrypt_ti, aes_128_encrypt_ti_x, aes_128_encrypt_expanded_ti_x};
+    const char *comp = "ref", *mb = "ref", *aes = "ref";
+
+    features &= cpu_features();
+
+#ifdef CPU_X86
+    if (features & CPU_SHANI) {
+        t.comp = sha256_ni_comp;
+        t.prf32 = prg32_ni;
+        t.features |= CPU_SSE41 | CPU_SHANI;
+        comp = "shani";
+    }
+
+    // One SHA extensions lane costs about a sixth of a 16-lane AVX-512 pass, so AVX-512 only
+    // wins for well filled groups. Without AVX-512, the interleaved SHA-NI pairs beat 8-lane AVX2.
+    if (features & CPU_AVX512) {
+        if (features & CPU_SHANI) {
+            t.mb_comp = sha256_mb_comp_avx512_ni;
+            mb = "avx512+shani";
+        } else {
+            t.mb_comp = sha256_mb_comp_avx512;
+            mb = "avx512";
+        }
+        t.mb_lanes = SHA256_MB_LANES_AVX512;
+        t.features |= CPU_AVX512;
+    } else if (features & CPU_SHANI) {
+        t.mb_comp = sha256_mb_comp_ni;
+        t.mb_lanes = 2;
+        mb = "shani";
+    } else if (features & CPU_AVX2) {
+        t.mb_comp = sha256_mb_comp_avx2;
+        t.mb_lanes = SHA256_MB_LANES_AVX2;
+        t.features |= CPU_AVX2;
+        mb = "avx2";
+    }
+
+    if (features & CPU_AESNI) {
+        t.aes_enc = aes_128_encrypt_ni;
+        t.aes_enc_x = aes_128_encrypt_ni_x;
+        t.aes_enc_expanded_x = aes_128_encrypt_expanded_ni_x;
+        t.features |= CPU_AESNI;
+        aes = "aesni";
+    }
+#endif
+
+    snprintf(t.name, sizeof t.name, "sha256=%s mb=%s(%u) prf=%s aes=%s", comp, mb, t.mb_lanes, comp, aes);
+    dispatch = t;
+}
+
+int dispatch_force(const char *backend) {
+    unsigned int i, len, features = 0;
+    const char *p = backend;
+
+    while (*p) {
+        len = strcspn(p, "+");
+        for (i = 0; i < sizeof _backends / sizeof _backends[0]; i++)
+            if (strlen(_backends[i].name) == len && strncmp(p, _backends[i].name, len) == 0)
+                break;
+        if (i == sizeof _backends / sizeof _backends[0])
+            return 0;
+        features |= _backends[i].features;
+        p += len;
+        if (*p == '+')
+            p++;
+    }
+    dispatch_select(features);
+    return 1;
+}
+
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+void dispatch_init(void) {
+    const char *backend = getenv(DISPATCH_ENV);
+
+    if (backend == NULL || !dispatch_force(backend)) // an unknown name keeps the default
+        dispatch_select(~0u);
+}
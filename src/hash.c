@@ -16,12 +16,18 @@
  */
 
 #include "hash.h"
+#include "dispatch.h"
+#include "sha2_ni.h"
 #include <string.h>
 
 #ifdef DEBUG
 #include <assert.h>
 #endif
 
+static const sph_u32 SHA256_IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
 /**
  * Recommendation is that rp is unpredictable and r is at least 128 bits to provide minimal security
  *  
@@ -29,63 +35,86 @@
  * @param rlen
  * @param rp        The expanded randomized value
  */
-void _rmx_salt(const unsigned char *r, const unsigned int rlen, unsigned char *rp);
+static void _etcr_salt(const unsigned char *r, unsigned int rlen, unsigned char rp[HASH_BLOCKSIZE]) {
+    // Salt expansion to coincide the hash block size: rp <- r | r | ... | r | r, where last r may be truncated
+    unsigned int rplen;
+
+    if (rlen == 0) {
+        memset(rp, 0, HASH_BLOCKSIZE);
+        return;
+    }
+    for (rplen = 0; rplen < HASH_BLOCKSIZE; rplen += rlen)
+        memcpy(&rp[rplen], r, (HASH_BLOCKSIZE - rplen < rlen) ? HASH_BLOCKSIZE - rplen : rlen);
+}
 
 /**
- * The randomization of the plain message as suggested in https://tools.ietf.org/html/draft-irtf-cfrg-rhash-01
- * 
- * @param rp                 The salt rp is xored with each data block and that will be concatenated with the randomized data later
- * @param r
- * @param rlen
- * @param d                 The plain data to be signed
- * @param dlen              The amount of bytes in data
- * @param randomizeddata     The sequence drp = rp || d1 XOR rp || ... dt XOR rp where di's are data blocks of length HASH_BLOCKSIZE and dt is possibly padded with zeros if needed
+ * Compress one block of plain data d, randomized on the fly as d xor rp.
  */
-void _rmx(unsigned char *rp, const unsigned char *r, const unsigned char rlen, const char *data, const unsigned long datalen, unsigned char *randomizeddata);
+static void _etcr_block(etcr_t *ctx, const unsigned char d[HASH_BLOCKSIZE]) {
+    unsigned char block[HASH_BLOCKSIZE];
+    unsigned int i;
 
-void _rmx_salt(const unsigned char *r, const unsigned int rlen, unsigned char *rp) {
-    // Salt expansion to coincide the hash block size: rp <- r | r | ... | r | r, where last r may be truncated
-    unsigned char rplen;  
-    if (rlen > HASH_BLOCKSIZE) {
-        memcpy(rp,r,HASH_BLOCKSIZE);
-        return;
-    }
-    memcpy(rp,r,rlen);  
-    rplen = rlen;
-    while (rplen+rlen < HASH_BLOCKSIZE) {
-        memcpy(&rp[rplen],r,rlen);
-        rplen = rplen+rlen;
-    }
-    if (rplen < HASH_BLOCKSIZE) {
-        memcpy(&rp[rplen],r,rplen+rlen - HASH_BLOCKSIZE);
-    }
+    for (i = 0; i < HASH_BLOCKSIZE; i++)
+        block[i] = d[i] ^ ctx->rp[i];
+    dispatch.comp(block, ctx->val);
+    ctx->blocks++;
 }
 
-void _rmx(unsigned char *rp, const unsigned char *r, const unsigned char rlen, const char *d, const unsigned long dlen, unsigned char *randomizeddata) {
-    unsigned long len;
- 
-    _rmx_salt(r, rlen, rp);
-    
-    // Prepare the randomized data: drp <- d1 xor rp || d2 xor rp || ... || dt xor rp
-    len = 0;
-    while (len < (dlen+HASH_BLOCKSIZE-1)/HASH_BLOCKSIZE) {
-        for (int i = 0; i < HASH_BLOCKSIZE / sizeof(int); i++) { // Compute di xor rp by integer steps
-            int temp = *((int*)&d[len+i*sizeof(int)]) ^ *((int*)&rp[i*sizeof(int)]);
-            memcpy(&randomizeddata[len+i*sizeof(int)], &temp, sizeof(int));            
+void etcr_init(etcr_t *ctx, const unsigned char *r, unsigned int rlen) {
+    _etcr_salt(r, rlen, ctx->rp);
+    memcpy(ctx->val, SHA256_IV, sizeof SHA256_IV);
+    dispatch.comp(ctx->rp, ctx->val); // rp itself is the first block of the randomized message
+    ctx->blocks = 1;
+    ctx->t = 0;
+}
+
+void etcr_update(etcr_t *ctx, const void *data, size_t datalen) {
+    const unsigned char *d = data;
+
+    if (ctx->t > 0) { // complete the pending block first
+        while (ctx->t < HASH_BLOCKSIZE && datalen > 0) {
+            ctx->buf[ctx->t] = *d++ ^ ctx->rp[ctx->t];
+            ctx->t++;
+            datalen--;
         }
-        len = len + HASH_BLOCKSIZE;
+        if (ctx->t < HASH_BLOCKSIZE)
+            return;
+        dispatch.comp(ctx->buf, ctx->val);
+        ctx->blocks++;
+        ctx->t = 0;
     }
+    for (; datalen >= HASH_BLOCKSIZE; datalen -= HASH_BLOCKSIZE, d += HASH_BLOCKSIZE)
+        _etcr_block(ctx, d);
+    for (; ctx->t < datalen; ctx->t++)
+        ctx->buf[ctx->t] = d[ctx->t] ^ ctx->rp[ctx->t];
+}
+
+void etcr_final(etcr_t *ctx, unsigned char h[HASH_OUTPUTSIZE]) {
+    unsigned int i;
 
+    // the data is padded with a 1 bit and zeros (then randomized like the rest) to a whole block
+    ctx->buf[ctx->t] = 0x80 ^ ctx->rp[ctx->t];
+    for (i = ctx->t + 1; i < HASH_BLOCKSIZE; i++)
+        ctx->buf[i] = ctx->rp[i];
+    dispatch.comp(ctx->buf, ctx->val);
+    ctx->blocks++;
+
+    // the randomized message is a whole number of blocks, so the SHA-256 padding is a block of its own
+    memset(ctx->buf, 0, HASH_BLOCKSIZE);
+    ctx->buf[0] = 0x80;
+    sph_enc64be(&ctx->buf[HASH_BLOCKSIZE - 8], ctx->blocks * HASH_BLOCKSIZE * 8);
+    dispatch.comp(ctx->buf, ctx->val);
+
+    for (i = 0; i < 8; i++)
+        sph_enc32be(&h[4 * i], ctx->val[i]);
 }
 
-void etcr_hash(const unsigned char *r, const unsigned char rlen, const char *data, const unsigned short datalen, unsigned char *h) {
-    unsigned char rp[HASH_BLOCKSIZE];
-    unsigned char randomizeddata[HASH_BLOCKSIZE*((datalen+HASH_BLOCKSIZE-1)/HASH_BLOCKSIZE)];
-    
-    memcpy(&randomizeddata,data,datalen);
-    _rmx(rp, r, rlen, data, datalen, randomizeddata);
-    hash32((const unsigned char *)randomizeddata, HASH_BLOCKSIZE*((datalen+HASH_BLOCKSIZE-1)/HASH_BLOCKSIZE), h);
-    
+void etcr_hash(const unsigned char *r, unsigned int rlen, const char *data, size_t datalen, unsigned char *h) {
+    etcr_t ctx;
+
+    etcr_init(&ctx, r, rlen);
+    etcr_update(&ctx, data, datalen);
+    etcr_final(&ctx, h);
 }
 
 void MMO_init(mmo_t *mmo) {
@@ -233,6 +262,49 @@ void MMO_hash32(mmo_t *mmo, const unsigned char M1[16], const unsigned char M2[1
     memcpy(tag, mmo->H, 16);
 }
 
+void MMO_hash16_x(const unsigned char *const M[], unsigned char *const tag[], unsigned int n) {
+    unsigned char H[HASH_MAX_LANES][AES_128_BLOCK_SIZE];
+    unsigned char *H_ptr[HASH_MAX_LANES];
+    unsigned int i, k, j, lanes;
+
+    for (i = 0; i < HASH_MAX_LANES; i++)
+        H_ptr[i] = H[i];
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+
+        aes128_encrypt_keyexpanded_x(H_ptr, &M[j], lanes); // IV=0, as in MMO_hash16
+        for (i = 0; i < lanes; i++)
+            for (k = 0; k < AES_128_BLOCK_SIZE; k++)
+                tag[j + i][k] = H[i][k] ^ M[j + i][k];
+    }
+}
+
+void MMO_hash32_x(const unsigned char *const M1[], const unsigned char *const M2[], unsigned char *const tag[], unsigned int n) {
+    unsigned char H[HASH_MAX_LANES][AES_128_BLOCK_SIZE];
+    unsigned char *H_ptr[HASH_MAX_LANES];
+    unsigned int i, k, j, lanes;
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+        for (i = 0; i < lanes; i++) {
+            memset(H[i], 0, AES_128_BLOCK_SIZE);
+            H[i][0] = 1; // the IV of MMO_hash32
+            H_ptr[i] = H[i];
+        }
+
+        aes_128_encrypt_x(H_ptr, &M1[j], (const unsigned char *const *) H_ptr, lanes);
+        for (i = 0; i < lanes; i++)
+            for (k = 0; k < AES_128_BLOCK_SIZE; k++)
+                H[i][k] ^= M1[j + i][k];
+
+        aes_128_encrypt_x(H_ptr, &M2[j], (const unsigned char *const *) H_ptr, lanes);
+        for (i = 0; i < lanes; i++)
+            for (k = 0; k < AES_128_BLOCK_SIZE; k++)
+                tag[j + i][k] = H[i][k] ^ M2[j + i][k];
+    }
+}
+
 void hash32(const unsigned char *in, unsigned int inlen, unsigned char *out) {
     sph_sha256_context ctx;
     
@@ -242,9 +314,20 @@ void hash32(const unsigned char *in, unsigned int inlen, unsigned char *out) {
     
 }
 
-void hmac(const unsigned char *key, unsigned int keylen, const unsigned char *message, unsigned int msglen, unsigned char *output) {
+void hash32_fixed32(const unsigned char in[HASH_OUTPUTSIZE], unsigned char out[HASH_OUTPUTSIZE]) {
+    sph_sha256_fixed32(SHA256_IV, 0, in, out);
+}
+
+void hash32_fixed64(const unsigned char left[HASH_OUTPUTSIZE], const unsigned char right[HASH_OUTPUTSIZE], unsigned char out[HASH_OUTPUTSIZE]) {
+    sph_sha256_fixed64(left, right, out);
+}
+
+/**
+ * Derive the inner and outer HMAC pad blocks from the key.
+ */
+static void _hmac_key_pads(const unsigned char *key, unsigned int keylen, unsigned char i_key_pad[HASH_BLOCKSIZE], unsigned char o_key_pad[HASH_BLOCKSIZE]) {
     sph_sha256_context ctx;
-    unsigned char o_key_pad[HASH_BLOCKSIZE], i_key_pad[HASH_BLOCKSIZE], temp[HASH_BLOCKSIZE];
+    unsigned char temp[HASH_BLOCKSIZE];
 
     memset(temp, 0, HASH_BLOCKSIZE);
     
@@ -264,15 +347,38 @@ void hmac(const unsigned char *key, unsigned int keylen, const unsigned char *me
     memcpy(i_key_pad, temp, HASH_BLOCKSIZE);
     o_key_pad[0] = ((unsigned int)(0x5c * HASH_BLOCKSIZE)) ^ temp[0];
     i_key_pad[0] = ((unsigned int)(0x36 * HASH_BLOCKSIZE)) ^ temp[0];
+}
 
-    sph_sha256_init(&ctx);
-    sph_sha256(&ctx, i_key_pad, HASH_BLOCKSIZE);
-    sph_sha256(&ctx, message, msglen);
-    sph_sha256_close(&ctx, temp);
-    sph_sha256_init(&ctx);
-    sph_sha256(&ctx, o_key_pad, HASH_BLOCKSIZE);
-    sph_sha256(&ctx, temp, HASH_OUTPUTSIZE);
-    sph_sha256_close(&ctx, output);
+void hmac_init(hmac_t *prf, const unsigned char *key, unsigned int keylen) {
+    unsigned char o_key_pad[HASH_BLOCKSIZE], i_key_pad[HASH_BLOCKSIZE];
+
+    _hmac_key_pads(key, keylen, i_key_pad, o_key_pad);
+
+    sph_sha256_init(&prf->inner);
+    sph_sha256(&prf->inner, i_key_pad, HASH_BLOCKSIZE);
+    sph_sha256_init(&prf->outer);
+    sph_sha256(&prf->outer, o_key_pad, HASH_BLOCKSIZE);
+}
+
+void hmac_eval(const hmac_t *prf, const unsigned char *message, unsigned int msglen, unsigned char *output) {
+    sph_sha256_context ctx;
+    unsigned char temp[HASH_OUTPUTSIZE];
+
+    if (msglen == HASH_OUTPUTSIZE) {
+        sph_sha256_fixed32(prf->inner.val, HASH_BLOCKSIZE, message, temp); // prg32 and other 32-byte inputs
+    } else {
+        sph_sha256_clone(&ctx, &prf->inner);
+        sph_sha256(&ctx, message, msglen);
+        sph_sha256_close(&ctx, temp);
+    }
+    sph_sha256_fixed32(prf->outer.val, HASH_BLOCKSIZE, temp, output); // the outer message is always one digest
+}
+
+void hmac(const unsigned char *key, unsigned int keylen, const unsigned char *message, unsigned int msglen, unsigned char *output) {
+    hmac_t prf;
+
+    hmac_init(&prf, key, keylen);
+    hmac_eval(&prf, message, msglen, output);
     
 }
 
@@ -280,16 +386,270 @@ void prg(const unsigned char seed[HASH_OUTPUTSIZE], uint64_t input, unsigned cha
     hmac(seed, HASH_OUTPUTSIZE, (unsigned char *)&input, 8, output);
 }
 
+void prg_init(hmac_t *prf, const unsigned char seed[HASH_OUTPUTSIZE]) {
+    hmac_init(prf, seed, HASH_OUTPUTSIZE);
+}
+
+void prg_eval(const hmac_t *prf, uint64_t input, unsigned char output[HASH_OUTPUTSIZE]) {
+    hmac_eval(prf, (unsigned char *)&input, 8, output);
+}
+
 void prg32(const unsigned char key[HASH_OUTPUTSIZE], const unsigned char input[HASH_OUTPUTSIZE], unsigned char output[HASH_OUTPUTSIZE]) {
+    dispatch.prf32(key, input, output);
+}
+
+void prg32_sph(const unsigned char key[HASH_OUTPUTSIZE], const unsigned char input[HASH_OUTPUTSIZE], unsigned char output[HASH_OUTPUTSIZE]) {
     hmac(key, HASH_OUTPUTSIZE, input, HASH_OUTPUTSIZE, output);
 }
 
+#ifdef CPU_X86
+void prg32_ni(const unsigned char key[HASH_OUTPUTSIZE], const unsigned char input[HASH_OUTPUTSIZE], unsigned char output[HASH_OUTPUTSIZE]) {
+    unsigned char i_key_pad[HASH_BLOCKSIZE], o_key_pad[HASH_BLOCKSIZE], block[HASH_BLOCKSIZE];
+    sph_u32 inner[8], outer[8];
+    unsigned int t;
+
+    _hmac_key_pads(key, HASH_OUTPUTSIZE, i_key_pad, o_key_pad);
+    memcpy(inner, SHA256_IV, sizeof SHA256_IV);
+    memcpy(outer, SHA256_IV, sizeof SHA256_IV);
+    sha256_ni_comp_x2(i_key_pad, inner, o_key_pad, outer); // the two key blocks are independent
+
+    // Both remaining blocks are 32 bytes of data after one key block: 0x80, zeros and the bit length 768
+    memcpy(block, input, HASH_OUTPUTSIZE);
+    memset(&block[HASH_OUTPUTSIZE], 0, HASH_BLOCKSIZE - HASH_OUTPUTSIZE);
+    block[HASH_OUTPUTSIZE] = 0x80;
+    sph_enc64be(&block[HASH_BLOCKSIZE - 8], (HASH_BLOCKSIZE + HASH_OUTPUTSIZE) << 3);
+    sha256_ni_comp(block, inner);
+
+    for (t = 0; t < 8; t++)
+        sph_enc32be(&block[4 * t], inner[t]);
+    sha256_ni_comp(block, outer);
+
+    for (t = 0; t < 8; t++)
+        sph_enc32be(&output[4 * t], outer[t]);
+}
+#endif
+
 void fsgen(const unsigned char seed[HASH_OUTPUTSIZE], unsigned char nextseed[HASH_OUTPUTSIZE], unsigned char rand[HASH_OUTPUTSIZE]) {
-    prg(seed, 1, rand);
-    prg(seed, 0, nextseed);
+    hmac_t prf;
+
+    prg_init(&prf, seed); // both outputs are keyed by seed, expand it once
+    prg_eval(&prf, 1, rand);
+    prg_eval(&prf, 0, nextseed);
     
 }
 
+/**
+ * Absorb n equal-length messages into the chaining values val and apply the SHA-256 padding,
+ * prelen being the number of bytes each lane has already compressed. Full blocks are read in place,
+ * only the padded tail is copied.
+ */
+static void _hash_final_x(sph_u32 val[][8], const unsigned char *const in[], unsigned int inlen, unsigned int prelen, unsigned int n) {
+    unsigned char tail[HASH_MAX_LANES][2 * HASH_BLOCKSIZE];
+    const unsigned char *block[HASH_MAX_LANES];
+    unsigned int i, off, rem = inlen % HASH_BLOCKSIZE, tailblocks = (rem < HASH_BLOCKSIZE - 8) ? 1 : 2;
+    uint64_t bitlen = (uint64_t) (prelen + inlen) << 3;
+
+    for (off = 0; off + HASH_BLOCKSIZE <= inlen; off += HASH_BLOCKSIZE) {
+        for (i = 0; i < n; i++)
+            block[i] = in[i] + off;
+        sha256_mb_comp(val, block, n);
+    }
+
+    for (i = 0; i < n; i++) {
+        memset(tail[i], 0, tailblocks * HASH_BLOCKSIZE);
+        memcpy(tail[i], in[i] + off, rem);
+        tail[i][rem] = 0x80;
+        sph_enc64be(&tail[i][tailblocks * HASH_BLOCKSIZE - 8], bitlen);
+    }
+    for (off = 0; off < tailblocks * HASH_BLOCKSIZE; off += HASH_BLOCKSIZE) {
+        for (i = 0; i < n; i++)
+            block[i] = tail[i] + off;
+        sha256_mb_comp(val, block, n);
+    }
+}
+
+/**
+ * HMAC over at most HASH_MAX_LANES lanes sharing key and message lengths.
+ */
+static void _hmac_x(const unsigned char *const key[], unsigned int keylen, const unsigned char *const message[], unsigned int msglen, unsigned char *const output[], unsigned int n) {
+    unsigned char i_key_pad[HASH_MAX_LANES][HASH_BLOCKSIZE], o_key_pad[HASH_MAX_LANES][HASH_BLOCKSIZE];
+    unsigned char inner[HASH_MAX_LANES][HASH_OUTPUTSIZE];
+    const unsigned char *block[HASH_MAX_LANES];
+    sph_u32 val[HASH_MAX_LANES][8];
+    unsigned int i, t;
+
+    for (i = 0; i < n; i++) {
+        _hmac_key_pads(key[i], keylen, i_key_pad[i], o_key_pad[i]);
+        memcpy(val[i], SHA256_IV, sizeof SHA256_IV);
+        block[i] = i_key_pad[i];
+    }
+    sha256_mb_comp(val, block, n);
+    _hash_final_x(val, message, msglen, HASH_BLOCKSIZE, n);
+
+    for (i = 0; i < n; i++) {
+        for (t = 0; t < 8; t++)
+            sph_enc32be(&inner[i][4 * t], val[i][t]);
+        memcpy(val[i], SHA256_IV, sizeof SHA256_IV);
+        block[i] = o_key_pad[i];
+    }
+    sha256_mb_comp(val, block, n);
+    for (i = 0; i < n; i++)
+        block[i] = inner[i];
+    _hash_final_x(val, block, HASH_OUTPUTSIZE, HASH_BLOCKSIZE, n);
+
+    for (i = 0; i < n; i++)
+        for (t = 0; t < 8; t++)
+            sph_enc32be(&output[i][4 * t], val[i][t]);
+}
+
+void hash32_x(const unsigned char *const in[], unsigned int inlen, unsigned char *const out[], unsigned int n) {
+    sph_u32 val[HASH_MAX_LANES][8];
+    unsigned int i, j, t, lanes;
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+        for (i = 0; i < lanes; i++)
+            memcpy(val[i], SHA256_IV, sizeof SHA256_IV);
+        _hash_final_x(val, &in[j], inlen, 0, lanes);
+        for (i = 0; i < lanes; i++)
+            for (t = 0; t < 8; t++)
+                sph_enc32be(&out[j + i][4 * t], val[i][t]);
+    }
+}
+
+void prg_x(const unsigned char *const seed[], const uint64_t input[], unsigned char *const output[], unsigned int n) {
+    const unsigned char *message[HASH_MAX_LANES];
+    unsigned int i, j, lanes;
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+        for (i = 0; i < lanes; i++)
+            message[i] = (const unsigned char *) &input[j + i];
+        _hmac_x(&seed[j], HASH_OUTPUTSIZE, message, 8, &output[j], lanes);
+    }
+}
+
+void prg32_x(const unsigned char *const key[], const unsigned char *const input[], unsigned char *const output[], unsigned int n) {
+    unsigned int j, lanes;
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+        _hmac_x(&key[j], HASH_OUTPUTSIZE, &input[j], HASH_OUTPUTSIZE, &output[j], lanes);
+    }
+}
+
+/**
+ * The second inner block of prg32: the 32-byte input after one key block, with 0x80, zeros and the bit length 768.
+ */
+static void _prg32_msg_block(const unsigned char input[HASH_OUTPUTSIZE], unsigned char msg[HASH_BLOCKSIZE]) {
+    memcpy(msg, input, HASH_OUTPUTSIZE);
+    memset(&msg[HASH_OUTPUTSIZE], 0, HASH_BLOCKSIZE - HASH_OUTPUTSIZE);
+    msg[HASH_OUTPUTSIZE] = 0x80;
+    sph_enc64be(&msg[HASH_BLOCKSIZE - 8], (HASH_BLOCKSIZE + HASH_OUTPUTSIZE) << 3);
+}
+
+/**
+ * One prg32 step on n <= HASH_MAX_LANES lanes under a common input: key[i] = prg32(key[i], input).
+ * msg is the padded block of the input, which every inner hash absorbs after its key block. The inner
+ * and outer key blocks are compressed in a single pass over 2n lanes.
+ */
+static void _prg32_step_x(unsigned char *const key[], const unsigned char msg[HASH_BLOCKSIZE], unsigned int n) {
+    unsigned char pad[2 * HASH_MAX_LANES][HASH_BLOCKSIZE], inner[HASH_MAX_LANES][HASH_BLOCKSIZE];
+    const unsigned char *block[2 * HASH_MAX_LANES];
+    sph_u32 val[2 * HASH_MAX_LANES][8];
+    unsigned int i, t;
+
+    for (i = 0; i < n; i++) {
+        _hmac_key_pads(key[i], HASH_OUTPUTSIZE, pad[i], pad[n + i]);
+        memcpy(val[i], SHA256_IV, sizeof SHA256_IV);
+        memcpy(val[n + i], SHA256_IV, sizeof SHA256_IV);
+    }
+    // point every slot at its pad, not just the 2n in use, so block is fully defined for any n
+    for (i = 0; i < 2 * HASH_MAX_LANES; i++)
+        block[i] = pad[i];
+    sha256_mb_comp(val, block, 2 * n);
+
+    for (i = 0; i < n; i++)
+        block[i] = msg;
+    sha256_mb_comp(val, block, n);
+
+    // the inner digest is 32 bytes after one key block, padded like msg
+    for (i = 0; i < n; i++) {
+        memcpy(&inner[i][HASH_OUTPUTSIZE], &msg[HASH_OUTPUTSIZE], HASH_BLOCKSIZE - HASH_OUTPUTSIZE);
+        for (t = 0; t < 8; t++)
+            sph_enc32be(&inner[i][4 * t], val[i][t]);
+        block[i] = inner[i];
+    }
+    sha256_mb_comp(&val[n], block, n);
+
+    for (i = 0; i < n; i++)
+        for (t = 0; t < 8; t++)
+            sph_enc32be(&key[i][4 * t], val[n + i][t]);
+}
+
+void prg32_chain_x(unsigned char *const chain[], const unsigned char input[HASH_OUTPUTSIZE], unsigned int steps, unsigned int n) {
+    unsigned char msg[HASH_BLOCKSIZE];
+    unsigned int j, s, lanes;
+
+    _prg32_msg_block(input, msg);
+
+    for (j = 0; j < n; j += lanes) {
+        lanes = (n - j < HASH_MAX_LANES) ? n - j : HASH_MAX_LANES;
+        for (s = 0; s < steps; s++)
+            _prg32_step_x(&chain[j], msg, lanes);
+    }
+}
+
+#define PRG32_CHAINS_BATCH 512 // chains ordered together by prg32_chains_x, more than the longest WOTS signature
+
+/**
+ * Lane scheduler of prg32_chains_x for n <= PRG32_CHAINS_BATCH chains.
+ */
+static void _prg32_chains_x(unsigned char *const chain[], const unsigned char msg[HASH_BLOCKSIZE], const unsigned int steps[], unsigned int n) {
+    unsigned char *lane[HASH_MAX_LANES];
+    unsigned int left[HASH_MAX_LANES];
+    unsigned int order[PRG32_CHAINS_BATCH];
+    unsigned int i, j, k, active = 0, next = 0;
+
+    // longest chains first, so that the short ones fill the lanes freed at the end; empty chains are dropped
+    for (i = 0, k = 0; i < n; i++) {
+        if (steps[i] == 0)
+            continue;
+        for (j = k++; j > 0 && steps[order[j - 1]] < steps[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    while (active > 0 || next < k) {
+        // refill the lanes of the chains that are done
+        while (active < HASH_MAX_LANES && next < k) {
+            lane[active] = chain[order[next]];
+            left[active++] = steps[order[next++]];
+        }
+        _prg32_step_x(lane, msg, active);
+        for (i = 0; i < active; ) {
+            if (--left[i] == 0) {
+                lane[i] = lane[--active];
+                left[i] = left[active];
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+void prg32_chains_x(unsigned char *const chain[], const unsigned char input[HASH_OUTPUTSIZE], const unsigned int steps[], unsigned int n) {
+    unsigned char msg[HASH_BLOCKSIZE];
+    unsigned int j, count;
+
+    _prg32_msg_block(input, msg);
+
+    for (j = 0; j < n; j += count) {
+        count = (n - j < PRG32_CHAINS_BATCH) ? n - j : PRG32_CHAINS_BATCH;
+        _prg32_chains_x(&chain[j], msg, &steps[j], count);
+    }
+}
+
 
 #ifdef MMO_SELFTEST
 
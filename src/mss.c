@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "mss.h"
 
@@ -35,6 +36,13 @@ unsigned char X[LEN_BYTES(WINTERNITZ_N)] = {0x2A, 0x94, 0x55, 0xE4, 0x6B, 0xFD,
 #define TREEHASH_MASK   0x1F
 #define TREEHASH_HEIGHT_INFINITY 0x7F
 
+// index of the last leaf, 2^64 leaves do not fit a uint64_t count
+#if MSS_HEIGHT == 64
+#define LAST_LEAF UINT64_MAX
+#else
+#define LAST_LEAF (((uint64_t) 1 << MSS_HEIGHT) - 1)
+#endif
+
 #if defined(DEBUG) || defined(MSS_SELFTEST)
 
 #include <assert.h>
@@ -55,8 +63,8 @@ unsigned long _count_trailing_zeros(const uint64_t v);
 
 void mss_node_print(const struct mss_node node);
 void print_stack(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned short top);
-void print_stack_push(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned short top, const struct mss_node node, const unsigned char pre_condition);
-void print_stack_pop(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned short top, const unsigned char pre_condition);
+void print_stack_push(const struct mss_node *stack, const unsigned short top, const struct mss_node node, const unsigned char pre_condition);
+void print_stack_pop(const struct mss_node *stack, const unsigned short top, const unsigned char pre_condition);
 void print_auth(const struct mss_state *state);
 void print_treehash(const struct mss_state *state);
 void get_auth_index(uint64_t s, unsigned short auth_index[MSS_HEIGHT]); // Return the index of the authentication path for s-th leaf
@@ -67,7 +75,21 @@ void print_retain(const struct mss_state *state);
 
 #endif
 
-void _create_leaf(struct mss_node *node, const uint64_t leaf_index, const unsigned char ri[LEN_BYTES(WINTERNITZ_N)]) {
+/**
+ * leaf = Hash(v) in the key's hash mode. For MMO, v is compressed by MMO_hash32 and the tag goes once more
+ * through MMO_hash16, so that a leaf is never computed like an inner node. leaf may alias v.
+ */
+void _leaf_hash(mmo_t *hash, unsigned char hash_mode, const unsigned char v[NODE_VALUE_SIZE], unsigned char leaf[NODE_VALUE_SIZE]) {
+    if (hash_mode == MSS_HASH_MMO) {
+        MMO_hash32(hash, v, v + AES_128_BLOCK_SIZE, leaf);
+        MMO_hash16(hash, leaf, leaf);
+        memset(leaf + AES_128_BLOCK_SIZE, 0, NODE_VALUE_SIZE - AES_128_BLOCK_SIZE);
+    } else {
+        hash32_fixed32(v, leaf);
+    }
+}
+
+void _create_leaf(mmo_t *hash, unsigned char hash_mode, struct mss_node *node, const uint64_t leaf_index, const unsigned char ri[LEN_BYTES(WINTERNITZ_N)]) {
 
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     // leaf_index must be between 0 and 2^MSS_HEIGHT-1
@@ -83,7 +105,7 @@ void _create_leaf(struct mss_node *node, const uint64_t leaf_index, const unsign
     winternitz_keygen(ri, X, node->value);
     
     // leaf = Hash(v)    
-    hash32(node->value, NODE_VALUE_SIZE, node->value);    
+    _leaf_hash(hash, hash_mode, node->value, node->value);
     node->height = 0;
     node->index = leaf_index;
 
@@ -94,7 +116,7 @@ void _create_leaf(struct mss_node *node, const uint64_t leaf_index, const unsign
 #endif
 }
 
-void _stack_push(struct mss_node stack[MSS_KEEP_SIZE], uint64_t *index, struct mss_node *node) {
+void _stack_push(struct mss_node *stack, uint64_t *index, struct mss_node *node) {
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     assert(*index >= 0);
     assert(_node_valid(node));
@@ -115,7 +137,7 @@ void _stack_push(struct mss_node stack[MSS_KEEP_SIZE], uint64_t *index, struct m
 #endif
 }
 
-void _stack_pop(struct mss_node stack[MSS_KEEP_SIZE], uint64_t *index, struct mss_node *node) {
+void _stack_pop(struct mss_node *stack, uint64_t *index, struct mss_node *node) {
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     assert(*index > 0);
     const uint64_t prior_index = *index;
@@ -135,7 +157,7 @@ void _stack_pop(struct mss_node stack[MSS_KEEP_SIZE], uint64_t *index, struct ms
 #endif
 }
 
-void _get_parent(const struct mss_node *left_child, const struct mss_node *right_child, struct mss_node *parent) {
+void _get_parent(mmo_t *hash, unsigned char hash_mode, const struct mss_node *left_child, const struct mss_node *right_child, struct mss_node *parent) {
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     unsigned char parent_height = left_child->height + 1;
     uint64_t parent_index = left_child->index / 2;
@@ -159,11 +181,13 @@ void _get_parent(const struct mss_node *left_child, const struct mss_node *right
 #endif
 #endif
     
-    sph_sha256_context ctx;    
-    sph_sha256_init(&ctx);
-    sph_sha256(&ctx, left_child, NODE_VALUE_SIZE);
-    sph_sha256(&ctx, right_child, NODE_VALUE_SIZE);
-    sph_sha256_close(&ctx, parent->value);    
+    // parent = Hash(left || right) over the children's values
+    if (hash_mode == MSS_HASH_MMO) {
+        MMO_hash32(hash, left_child->value, right_child->value, parent->value);
+        memset(parent->value + AES_128_BLOCK_SIZE, 0, NODE_VALUE_SIZE - AES_128_BLOCK_SIZE);
+    } else {
+        hash32_fixed64(left_child->value, right_child->value, parent->value);
+    }
 
     parent->height = left_child->height + 1;
     parent->index = (left_child->index >> 1);
@@ -187,6 +211,14 @@ void init_state(struct mss_state *state) {
 
     memset(state->treehash_state, TREEHASH_FINISHED, MSS_TREEHASH_SIZE);
     memset(state->retain_index, 0, (MSS_K - 1) * sizeof(uint64_t));
+    memset(state->ladder_index, 0xFF, sizeof state->ladder_index);
+    memset(state->ladder, 0, sizeof state->ladder);
+    memset(state->rung_index, 0xFF, sizeof state->rung_index);
+    memset(state->rung, 0, sizeof state->rung);
+    state->budget = 0;
+    state->work = 0;
+    memset(state->ahead, 0, sizeof state->ahead);
+    state->leaves = NULL;
     
 }
 
@@ -248,13 +280,119 @@ unsigned char _treehash_height(struct mss_state *state, unsigned char h) {
     return height;
 }
 
+/**
+ * Whether treehash h takes leaf from store[h], where the treehash above left it, instead of computing it.
+ */
+static int _treehash_recovers(const unsigned char h, const uint64_t leaf) {
+    return h < MSS_TREEHASH_SIZE - 1 && (leaf >= 11 * ((uint64_t) 1 << h)) && (((leaf - 11 * ((uint64_t) 1 << h)) % ((uint64_t) 1 << (2 + h))) == 0);
+}
+
+/**
+ * Walk the forward secure chain of treehash h towards leaf, by at most max fsgen calls, from the closest seed
+ * before it: the checkpoint this treehash left, or the current one. A treehash only skips ahead when it restarts,
+ * so most leaves are one fsgen away instead of up to 3*2^h. Returns 1 once the next fsgen of ladder[h] gives leaf.
+ */
+static int _treehash_walk(struct mss_state *state, const unsigned char h, const uint64_t current_leaf,
+                          const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], const uint64_t leaf, uint64_t max) {
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+    uint64_t i = current_leaf + 1; // the next fsgen of seed gives leaf current_leaf+1
+
+    if (state->ladder_index[h] > leaf || state->ladder_index[h] <= i) {
+        memcpy(state->ladder[h], seed, LEN_BYTES(WINTERNITZ_N));
+        state->ladder_index[h] = i;
+    }
+    for (; state->ladder_index[h] < leaf && max > 0; max--) {
+        fsgen(state->ladder[h], state->ladder[h], ri);
+        state->ladder_index[h]++;
+        state->work += MSS_COST_FSGEN;
+    }
+    memset(ri, 0, sizeof ri);
+
+    return state->ladder_index[h] == leaf;
+}
+
+/**
+ * Keep seed, the one before leaf in the fsgen chain, as rung h if leaf is 3*2^h after first, the next leaf to sign.
+ */
+static void _rung_keep(unsigned char rung[MSS_TREEHASH_SIZE][LEN_BYTES(WINTERNITZ_N)], uint64_t rung_index[MSS_TREEHASH_SIZE],
+                       const uint64_t first, const uint64_t leaf, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)]) {
+    unsigned char h;
+
+    for (h = 0; h < MSS_TREEHASH_SIZE; h++) {
+        if (leaf == first + 3 * ((uint64_t) 1 << h)) {
+            memcpy(rung[h], seed, LEN_BYTES(WINTERNITZ_N));
+            rung_index[h] = leaf;
+        }
+    }
+}
+
+/**
+ * Move every rung to 3*2^h leaves after s+1, whose seed is given: one fsgen each, unless the rung was never set.
+ */
+static void _rungs_advance(struct mss_state *state, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], const uint64_t s) {
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+    uint64_t target;
+    unsigned char h;
+
+    for (h = 0; h < MSS_TREEHASH_SIZE; h++) {
+        target = s + 1 + 3 * ((uint64_t) 1 << h);
+        if (target > LAST_LEAF || target < s) { // treehash h does not restart any more
+            memset(state->rung[h], 0, LEN_BYTES(WINTERNITZ_N));
+            state->rung_index[h] = UINT64_MAX;
+            continue;
+        }
+        if (state->rung_index[h] > target || state->rung_index[h] <= s + 1) {
+            memcpy(state->rung[h], seed, LEN_BYTES(WINTERNITZ_N));
+            state->rung_index[h] = s + 1;
+        }
+        for (; state->rung_index[h] < target; state->rung_index[h]++) {
+            fsgen(state->rung[h], state->rung[h], ri);
+            state->work += MSS_COST_FSGEN;
+        }
+    }
+    memset(ri, 0, sizeof ri);
+}
+
+/**
+ * Wipe the checkpoints at leaf s+1 or before: s is signed, and a seed before it would give its WOTS key again.
+ */
+static void _ladders_wipe(struct mss_state *state, const uint64_t s) {
+    unsigned char h;
+
+    for (h = 0; h < MSS_TREEHASH_SIZE; h++) {
+        if (state->ladder_index[h] <= s + 1) {
+            memset(state->ladder[h], 0, LEN_BYTES(WINTERNITZ_N));
+            state->ladder_index[h] = UINT64_MAX;
+        }
+    }
+}
+
+/**
+ * Compute the next leaf of treehash h into node, walking its ladder.
+ */
+static void _treehash_leaf(mmo_t *hash1, struct mss_state *state, const unsigned char h, const uint64_t current_leaf,
+                           const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], const uint64_t leaf, struct mss_node *node) {
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+
+    if (state->leaves != NULL) { // replayed by mss_keygen_core_shards
+        node->height = 0;
+        node->index = leaf;
+        memcpy(node->value, state->leaves[leaf], NODE_VALUE_SIZE);
+        return;
+    }
+    _treehash_walk(state, h, current_leaf, seed, leaf, UINT64_MAX);
+    fsgen(state->ladder[h], state->ladder[h], ri);
+    state->ladder_index[h]++;
+    _create_leaf(hash1, state->hash_mode, node, leaf, ri);
+    memset(ri, 0, sizeof ri);
+    state->work += MSS_COST_FSGEN + MSS_COST_LEAF;
+}
+
 void _treehash_update(mmo_t *hash1, struct mss_state *state, const unsigned char h, 
-                      struct mss_node *node1, struct mss_node *node2, unsigned int current_leaf,
+                      struct mss_node *node1, struct mss_node *node2, const uint64_t current_leaf,
                       unsigned char seed[LEN_BYTES(WINTERNITZ_N)]) {
-    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
-    uint64_t i;
     
-    if (h < MSS_TREEHASH_SIZE - 1 && (state->treehash_seed[h] >= 11 * (1 << h)) && (((state->treehash_seed[h] - 11 * (1 << h)) % (1 << (2 + h))) == 0)) {
+    if (_treehash_recovers(h, state->treehash_seed[h])) {
         node1->height = 0;
         node1->index = state->treehash_seed[h];
         memcpy(node1->value, state->store[h].value, NODE_VALUE_SIZE);
@@ -266,13 +404,13 @@ void _treehash_update(mmo_t *hash1, struct mss_state *state, const unsigned char
 #ifdef DEBUG
         printf("Calc leaf in treehash[%d]: %llu \n", h, state->treehash_seed[h]);
 #endif
-        memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));        
-        for (i = current_leaf; i < state->treehash_seed[h]; i++)
-            fsgen(si, si, ri);
-        _create_leaf(node1, state->treehash_seed[h], ri);
+        if (state->ahead[h] > state->treehash_seed[h] && state->pending[h][state->treehash_seed[h] % MSS_TREEHASH_AHEAD].index == state->treehash_seed[h])
+            *node1 = state->pending[h][state->treehash_seed[h] % MSS_TREEHASH_AHEAD]; // computed by _treehash_prefetch
+        else
+            _treehash_leaf(hash1, state, h, current_leaf, seed, state->treehash_seed[h], node1);
     }
 
-    if (h > 0 && (state->treehash_seed[h] >= 11 * (1 << (h - 1))) && ((state->treehash_seed[h] - 11 * (1 << (h - 1))) % (1 << (h + 1)) == 0)) {
+    if (h > 0 && (state->treehash_seed[h] >= 11 * ((uint64_t) 1 << (h - 1))) && ((state->treehash_seed[h] - 11 * ((uint64_t) 1 << (h - 1))) % ((uint64_t) 1 << (h + 1)) == 0)) {
         state->store[h - 1].height = 0;
         state->store[h - 1].index = state->treehash_seed[h];
         memcpy(state->store[h - 1].value, node1->value, NODE_VALUE_SIZE);
@@ -287,7 +425,8 @@ void _treehash_update(mmo_t *hash1, struct mss_state *state, const unsigned char
 #if MSS_STACK_SIZE != 0
     while (state->stack_index > 0 && _treehash_get_tailheight(state, h) == state->stack[state->stack_index - 1].height && (_treehash_get_tailheight(state, h) + 1) < h) {
         _stack_pop(state->stack, &state->stack_index, node2);
-        _get_parent(node2, node1, node1);
+        _get_parent(hash1, state->hash_mode, node2, node1, node1);
+        state->work += MSS_COST_PARENT;
         _treehash_set_tailheight(state, h, _treehash_get_tailheight(state, h) + 1);
     }
 #endif
@@ -300,7 +439,8 @@ void _treehash_update(mmo_t *hash1, struct mss_state *state, const unsigned char
     } else {
         if ((state->treehash_state[h] & TREEHASH_RUNNING) && (node1->index & 1)) { // if treehash *is used*
             *node2 = state->treehash[h];
-            _get_parent(node2, node1, node1);
+            _get_parent(hash1, state->hash_mode, node2, node1, node1);
+            state->work += MSS_COST_PARENT;
             _treehash_set_tailheight(state, h, _treehash_get_tailheight(state, h) + 1);
         }
         state->treehash[h] = *node1;
@@ -314,7 +454,7 @@ void _treehash_update(mmo_t *hash1, struct mss_state *state, const unsigned char
 }
 
 void _retain_push(struct mss_state *state, struct mss_node *node) {
-    uint64_t index = (1 << (MSS_HEIGHT - node->height - 1)) - (MSS_HEIGHT - node->height - 1) - 1 + (node->index >> 1) - 1;
+    uint64_t index = ((uint64_t) 1 << (MSS_HEIGHT - node->height - 1)) - (MSS_HEIGHT - node->height - 1) - 1 + (node->index >> 1) - 1;
     
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     assert(_node_valid(node));
@@ -327,13 +467,13 @@ void _retain_push(struct mss_state *state, struct mss_node *node) {
 
 void _retain_pop(struct mss_state *state, struct mss_node *node, unsigned short h) {
     uint64_t hbar = (MSS_HEIGHT - h - 1);
-    uint64_t index = (1 << hbar) - hbar - 1 + state->retain_index[h - (MSS_HEIGHT - MSS_K)];
+    uint64_t index = ((uint64_t) 1 << hbar) - hbar - 1 + state->retain_index[h - (MSS_HEIGHT - MSS_K)];
     
 #if defined(DEBUG) || defined(MSS_SELFTEST)
     assert(h <= MSS_HEIGHT - 2);
     assert(h >= MSS_HEIGHT - MSS_K);
     assert(state->retain_index[h - (MSS_HEIGHT - MSS_K)] >= 0);
-    assert(state->retain_index[h - (MSS_HEIGHT - MSS_K)] < (1 << hbar) - 1);
+    assert(state->retain_index[h - (MSS_HEIGHT - MSS_K)] < ((uint64_t) 1 << hbar) - 1);
     assert(index >= 0);
     assert(index < MSS_RETAIN_SIZE);
 #endif
@@ -397,58 +537,274 @@ unsigned long _count_trailing_zeros(const uint64_t v) {
     return tz;
 }
 
+/**
+ * One step of the walk of mss_keygen_core: leaf pos from the seed si, which moves on to the next leaf, merged into
+ * the keep stack of depth *index. After the last leaf node1 is the root.
+ */
+static void _keygen_leaf(mmo_t *hash1, unsigned char hash_mode, struct mss_state *state, uint64_t pos, unsigned char si[LEN_BYTES(WINTERNITZ_N)],
+                         uint64_t *index, struct mss_node *node1, struct mss_node *node2) {
+    const uint64_t maxleaf_index = ~(uint64_t) 0;
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+
+    _rung_keep(state->rung, state->rung_index, 0, pos, si);
+    fsgen(si, si, ri); //(seed_{i+1}, Ri) = F_{seed_i}(0)||F_{seed_i}(1)
+    _create_leaf(hash1, hash_mode, node1, pos, ri); //node1.height := 0
+#if defined(DEBUG)
+    mss_node_print(*node1);
+#endif
+    _init_state(state, node1);
+    while (node1->height < (pos == maxleaf_index ? 64 : _count_trailing_zeros(pos + 1))) { // Condition from algorithm 4.2 in Busold's thesis, adapted for uint64_t variables
+        _stack_pop(state->keep, index, node2);
+        _get_parent(hash1, hash_mode, node2, node1, node1);
+#if defined(DEBUG)
+        mss_node_print(*node1);
+#endif
+        _init_state(state, node1);
+    }
+    if (*index < MSS_HEIGHT)
+        _stack_push(state->keep, index, node1);
+    memset(ri, 0, sizeof ri);
+}
+
 void mss_keygen_core(mmo_t *hash1, mmo_t *hash2, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], 
                      struct mss_node *node1, struct mss_node *node2, struct mss_state *state, 
-                     unsigned char pkey[NODE_VALUE_SIZE]) {
+                     unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode) {
     uint64_t i, index = 0;
     uint64_t pos, maxleaf_index = (((uint64_t)1 << 63)-1) + ((uint64_t)1 << 63);
     uint64_t loop_bound = (MSS_HEIGHT == 64 ? maxleaf_index : ((uint64_t)1 << MSS_HEIGHT)-1);
-    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)];
 
     init_state(state);
+    state->hash_mode = hash_mode;
     memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
 
-    for (pos = 0; pos <= loop_bound; pos++) {
+    for (pos = 0; pos <= loop_bound; pos++)
+        _keygen_leaf(hash1, hash_mode, state, pos, si, &index, node1, node2);
+    memset(si, 0, sizeof si);
 
-        if (pos == 476579) {
-            i = 2;
-        }
-        
-        fsgen(si, si, ri); //(seed_{i+1}, Ri) = F_{seed_i}(0)||F_{seed_i}(1)
-        _create_leaf(node1, pos, ri); //node1.height := 0
 #if defined(DEBUG)
-        mss_node_print(*node1);
+    print_auth(state);
+    print_treehash(state);
+    print_retain(state);
 #endif
+    
+    for (i = 0; i < NODE_VALUE_SIZE; i++)
+        pkey[i] = node1->value[i];
+    
+}
+
+/**
+ * One subtree of mss_keygen_core_mt: its root, and for each depth of the keep stack the last node the serial walk
+ * pushes there while going through the subtree's leaves.
+ */
+struct _keygen_subtree {
+    unsigned char seed[LEN_BYTES(WINTERNITZ_N)];   // si before the fsgen of the first leaf
+    struct mss_node root;
+    struct mss_node keep[MSS_KEEP_SIZE];
+    unsigned char pushed[MSS_KEEP_SIZE];
+};
+
+struct _keygen_job {
+    struct mss_state *state;
+    struct _keygen_subtree *sub;
+    unsigned char (*leaves)[NODE_VALUE_SIZE];      // every leaf value, if not NULL
+    unsigned int t, next;                           // next: the next subtree to build, taken atomically
+    unsigned char hash_mode;
+};
+
+/**
+ * The serial walk of mss_keygen_core over the leaves of subtree s, stopping at its root. The nodes of different
+ * subtrees land in different entries of the state, so the workers share it. The keep stack starts at the depth
+ * the serial walk has there: one node per set bit of s.
+ */
+static void _keygen_subtree(struct _keygen_job *job, uint64_t s) {
+    const unsigned int height = MSS_HEIGHT - job->t;
+    struct _keygen_subtree *sub = &job->sub[s];
+    struct mss_node node1, node2;
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    uint64_t pos, first = s << height, last = first + ((uint64_t) 1 << height) - 1, index = 0, b;
+    unsigned long top;
+    mmo_t hash;
+
+    for (b = s; b; b >>= 1)
+        index += b & 1;
+    memcpy(si, sub->seed, LEN_BYTES(WINTERNITZ_N));
+    memset(sub->pushed, 0, sizeof sub->pushed);
+
+    for (pos = first; pos <= last; pos++) {
+        fsgen(si, si, ri);
+        _create_leaf(&hash, job->hash_mode, &node1, pos, ri);
+        if (job->leaves != NULL)
+            memcpy(job->leaves[pos], node1.value, NODE_VALUE_SIZE);
+        _init_state(job->state, &node1);
+        top = (pos == last) ? height : _count_trailing_zeros(pos + 1);
+        while (node1.height < top) {
+            _stack_pop(sub->keep, &index, &node2);
+            _get_parent(&hash, job->hash_mode, &node2, &node1, &node1);
+            if (node1.height < height) // the root is handed to the caller
+                _init_state(job->state, &node1);
+        }
+        if (pos != last && index < MSS_HEIGHT) {
+            sub->pushed[index] = 1;
+            _stack_push(sub->keep, &index, &node1);
+        }
+    }
+    sub->root = node1;
+    memset(si, 0, sizeof si);
+    memset(ri, 0, sizeof ri);
+}
+
+static void *_keygen_worker(void *arg) {
+    struct _keygen_job *job = arg;
+    uint64_t s;
+
+    while ((s = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < ((uint64_t) 1 << job->t))
+        _keygen_subtree(job, s);
+
+    return NULL;
+}
+
+/**
+ * mss_keygen_core_mt, which also gives every leaf value in leaves, the first seed of each subtree in seeds and
+ * the rungs a signer starting at each subtree would have in rungs, when they are not NULL
+ */
+static unsigned char _keygen_core_mt(mmo_t *hash1, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], struct mss_node *node1, 
+                                     struct mss_node *node2, struct mss_state *state, unsigned char pkey[NODE_VALUE_SIZE], 
+                                     unsigned char hash_mode, unsigned int t, unsigned int threads, 
+                                     unsigned char (*leaves)[NODE_VALUE_SIZE], unsigned char (*seeds)[LEN_BYTES(WINTERNITZ_N)],
+                                     unsigned char (*rungs)[MSS_TREEHASH_SIZE][LEN_BYTES(WINTERNITZ_N)]) {
+    struct _keygen_job job;
+    pthread_t worker[MSS_KEYGEN_MAX_THREADS];
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    uint64_t s, j, nsub, index = 0, width, pos, gap;
+    unsigned int k, started;
+    unsigned long top;
+
+    if (t == 0 || t >= MSS_HEIGHT || t > MSS_KEYGEN_MAX_LOG_SUBTREES || threads == 0 || threads > MSS_KEYGEN_MAX_THREADS)
+        return MSS_ERROR;
+    nsub = (uint64_t) 1 << t;
+    width = (uint64_t) 1 << (MSS_HEIGHT - t);
+    job.sub = malloc(nsub * sizeof (struct _keygen_subtree));
+    if (job.sub == NULL)
+        return MSS_ERROR;
+
+    init_state(state);
+    state->hash_mode = hash_mode;
+    job.state = state;
+    job.leaves = leaves;
+    job.t = t;
+    job.next = 0;
+    job.hash_mode = hash_mode;
+
+    // the fsgen ladder is sequential but cheap next to the leaves: walk it once for the first seed of each subtree
+    memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+    for (s = 0; s < nsub; s++) {
+        memcpy(job.sub[s].seed, si, LEN_BYTES(WINTERNITZ_N));
+        if (seeds != NULL)
+            memcpy(seeds[s], si, LEN_BYTES(WINTERNITZ_N));
+        for (j = 0; j < width; j++) {
+            pos = s * width + j;
+            _rung_keep(state->rung, state->rung_index, 0, pos, si);
+            for (k = 0; rungs != NULL && k < MSS_TREEHASH_SIZE; k++) {
+                gap = 3 * ((uint64_t) 1 << k);
+                if (pos >= gap && (pos - gap) % width == 0)
+                    memcpy(rungs[(pos - gap) / width][k], si, LEN_BYTES(WINTERNITZ_N));
+            }
+            fsgen(si, si, ri);
+        }
+    }
+
+    for (started = 0; started + 1 < threads; started++)
+        if (pthread_create(&worker[started], NULL, _keygen_worker, &job) != 0)
+            break; // fewer workers, the caller takes the rest
+    _keygen_worker(&job);
+    for (k = 0; k < started; k++)
+        pthread_join(worker[k], NULL);
+
+    // replay the top of the serial walk: the subtree's pushes in order, then its root climbing as far as it goes
+    for (s = 0; s < nsub; s++) {
+        for (j = 0; j < MSS_KEEP_SIZE; j++)
+            if (job.sub[s].pushed[j])
+                state->keep[j] = job.sub[s].keep[j];
+        *node1 = job.sub[s].root;
         _init_state(state, node1);
-        while (node1->height < (pos == maxleaf_index ? 64 : _count_trailing_zeros(pos + 1))) { // Condition from algorithm 4.2 in Busold's thesis, adapted for uint64_t variables
+        top = (MSS_HEIGHT - t) + ((s + 1 == nsub) ? t : _count_trailing_zeros(s + 1));
+        while (node1->height < top) {
             _stack_pop(state->keep, &index, node2);
-            _get_parent(node2, node1, node1);
-#if defined(DEBUG)
-            mss_node_print(*node1);
-#endif
+            _get_parent(hash1, hash_mode, node2, node1, node1);
             _init_state(state, node1);
         }
         if (index < MSS_HEIGHT)
             _stack_push(state->keep, &index, node1);
     }
 
-#if defined(DEBUG)
-    print_auth(state);
-    print_treehash(state);
-    print_retain(state);
-#endif
-    
-    for (i = 0; i < NODE_VALUE_SIZE; i++)
-        pkey[i] = node1->value[i];
-    
+    memcpy(pkey, node1->value, NODE_VALUE_SIZE);
+    memset(job.sub, 0, nsub * sizeof (struct _keygen_subtree));
+    free(job.sub);
+    memset(si, 0, sizeof si);
+    memset(ri, 0, sizeof ri);
+
+    return MSS_OK;
+}
+
+unsigned char mss_keygen_core_mt(mmo_t *hash1, mmo_t *hash2, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], 
+                                 struct mss_node *node1, struct mss_node *node2, struct mss_state *state, 
+                                 unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode, unsigned int t, unsigned int threads) {
+    (void) hash2;
+
+    return _keygen_core_mt(hash1, seed, node1, node2, state, pkey, hash_mode, t, threads, NULL, NULL, NULL);
+}
+
+/**
+ * Spend what is left of state->budget on the next leaves of the unfinished treehash instances, lowest tail first
+ * as the updates will take them, at most MSS_TREEHASH_AHEAD per instance. Long seed walks are split across calls.
+ */
+static void _treehash_prefetch(struct mss_state *state, mmo_t *hash1, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], const uint64_t s) {
+    uint64_t leaf, end, from, cost;
+    int64_t h, k;
+
+    for (;;) {
+        k = -1;
+        for (h = MSS_TREEHASH_SIZE - 1; h >= 0; h--) {
+            if (state->treehash_state[h] & TREEHASH_FINISHED)
+                continue;
+            if (state->ahead[h] < state->treehash_seed[h])
+                state->ahead[h] = state->treehash_seed[h];
+            end = (state->treehash_seed[h] & ~(((uint64_t) 1 << h) - 1)) + ((uint64_t) 1 << h); // instances cover aligned ranges
+            if (state->ahead[h] < end && state->ahead[h] < state->treehash_seed[h] + MSS_TREEHASH_AHEAD
+                && (k < 0 || _treehash_height(state, h) <= _treehash_height(state, k)))
+                k = h;
+        }
+        if (k < 0)
+            return;
+
+        leaf = state->ahead[k];
+        if (_treehash_recovers(k, leaf)) {
+            state->ahead[k]++;
+            continue;
+        }
+        from = (state->ladder_index[k] <= leaf && state->ladder_index[k] > s + 1) ? state->ladder_index[k] : s + 1;
+        cost = (leaf - from + 1) * MSS_COST_FSGEN + MSS_COST_LEAF;
+        if (state->work + cost > state->budget) {
+            if (state->work + MSS_COST_FSGEN <= state->budget) // at least get closer
+                _treehash_walk(state, k, s, seed, leaf, (state->budget - state->work) / MSS_COST_FSGEN);
+            return;
+        }
+        _treehash_leaf(hash1, state, k, s, seed, leaf, &state->pending[k][leaf % MSS_TREEHASH_AHEAD]);
+        state->ahead[k]++;
+    }
 }
 
 void _nextAuth(struct mss_state *state, struct mss_node *current_leaf, unsigned char seed[LEN_BYTES(WINTERNITZ_N)], 
                mmo_t *hash1, struct mss_node *node1, struct mss_node *node2, const uint64_t s) {
     unsigned char tau = MSS_HEIGHT - 1;
     int64_t min, h, i, j, k;
+    uint64_t target;
 
-    while ((s + 1) % (1 << tau) != 0)
+    state->work = 0;
+    if (state->leaves == NULL) // not in a replay, which has no seeds
+        _rungs_advance(state, seed, s);
+    while ((s + 1) % ((uint64_t) 1 << tau) != 0)
         tau--;
 
 #if defined(DEBUG)
@@ -461,15 +817,22 @@ void _nextAuth(struct mss_state *state, struct mss_node *current_leaf, unsigned
     if (tau == 0) { // next leaf is a right node		
         state->auth[0] = *current_leaf; // Leaf was already computed because our nonce
     } else { // next leaf is a left node
-        _get_parent(&state->auth[tau - 1], &state->keep[tau - 1], &state->auth[tau]);
+        _get_parent(hash1, state->hash_mode, &state->auth[tau - 1], &state->keep[tau - 1], &state->auth[tau]);
+        state->work += MSS_COST_PARENT;
         min = (tau - 1 < MSS_HEIGHT - MSS_K - 1) ? tau - 1 : MSS_HEIGHT - MSS_K - 1;
         for (h = 0; h <= min; h++) {
             state->auth[h] = state->treehash[h]; //Do Treehash_h.pop()
 
-            if (((unsigned long) s + 1 + 3 * (1 << h)) < ((unsigned long) 1 << MSS_HEIGHT))
-                _treehash_initialize(state, h, s + 1 + 3 * (1 << h));
-            else
+            target = s + 1 + 3 * ((uint64_t) 1 << h);
+            if (target <= LAST_LEAF && target > s) {
+                _treehash_initialize(state, h, target);
+                if (state->rung_index[h] == state->treehash_seed[h]) { // the restart is where the rung is
+                    memcpy(state->ladder[h], state->rung[h], LEN_BYTES(WINTERNITZ_N));
+                    state->ladder_index[h] = state->rung_index[h];
+                }
+            } else {
                 _treehash_state(state, h, TREEHASH_FINISHED);
+            }
         }
         h = MSS_HEIGHT - MSS_K;
         while (h < tau) {
@@ -491,10 +854,82 @@ void _nextAuth(struct mss_state *state, struct mss_node *current_leaf, unsigned
             _treehash_update(hash1, state, k, node1, node2, s, seed);
         }
     }
+    if (state->work < state->budget)
+        _treehash_prefetch(state, hash1, seed, s);
+    _ladders_wipe(state, s);
 }
 
-void _get_pkey(const struct mss_node auth[MSS_HEIGHT], struct mss_node *node, unsigned char *pkey) {
+unsigned char mss_keygen_core_shards(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], struct mss_shard *shard, 
+                                     unsigned char pkey[NODE_VALUE_SIZE], unsigned char hash_mode, unsigned int t, unsigned int threads) {
+    const uint64_t nleaves = (uint64_t) 1 << MSS_HEIGHT;
+    unsigned char (*leaves)[NODE_VALUE_SIZE], (*seeds)[LEN_BYTES(WINTERNITZ_N)], (*rungs)[MSS_TREEHASH_SIZE][LEN_BYTES(WINTERNITZ_N)];
+    struct mss_state *state;
+    struct mss_node node1, node2, leaf;
+    uint64_t s, c, nsub, width, r;
+    unsigned char h, status = MSS_ERROR;
+    mmo_t hash1;
+
+    if (t == 0 || t >= MSS_HEIGHT || t > MSS_KEYGEN_MAX_LOG_SUBTREES)
+        return MSS_ERROR;
+    nsub = (uint64_t) 1 << t;
+    width = (uint64_t) 1 << (MSS_HEIGHT - t);
+    leaves = malloc(nleaves * NODE_VALUE_SIZE);
+    seeds = malloc(nsub * LEN_BYTES(WINTERNITZ_N));
+    rungs = malloc(nsub * sizeof *rungs);
+    state = &shard[nsub - 1].state; // the replay ends at the first leaf of the last range
+
+    if (leaves != NULL && seeds != NULL && rungs != NULL
+        && _keygen_core_mt(&hash1, seed, &node1, &node2, state, pkey, hash_mode, t, threads, leaves, seeds, rungs) == MSS_OK) {
+        // The traversal steps of leaves 0 to the start of the last range, with the treehash leaves read back
+        state->leaves = (const unsigned char (*)[NODE_VALUE_SIZE]) leaves;
+        for (s = 0; s < (nsub - 1) * width; s++) {
+            if (s % width == 0) {
+                shard[s / width].state = *state;
+                shard[s / width].state.leaves = NULL;
+            }
+            leaf.height = 0;
+            leaf.index = s;
+            memcpy(leaf.value, leaves[s], NODE_VALUE_SIZE);
+            _nextAuth(state, &leaf, NULL, &hash1, &node1, &node2, s);
+        }
+        state->leaves = NULL;
+        state->work = 0;
+
+        for (c = 0; c < nsub; c++) {
+            memcpy(shard[c].si, seeds[c], LEN_BYTES(WINTERNITZ_N));
+            shard[c].index = c * width;
+            shard[c].end = (c + 1) * width;
+            // the replay had no seeds: the rungs are those of a signer at the first leaf of the range
+            for (h = 0; h < MSS_TREEHASH_SIZE; h++) {
+                r = c * width + 3 * ((uint64_t) 1 << h);
+                if (r < nleaves) {
+                    memcpy(shard[c].state.rung[h], rungs[c][h], LEN_BYTES(WINTERNITZ_N));
+                    shard[c].state.rung_index[h] = r;
+                } else {
+                    memset(shard[c].state.rung[h], 0, LEN_BYTES(WINTERNITZ_N));
+                    shard[c].state.rung_index[h] = UINT64_MAX;
+                }
+            }
+        }
+        status = MSS_OK;
+    }
+
+    if (seeds != NULL) {
+        memset(seeds, 0, nsub * LEN_BYTES(WINTERNITZ_N));
+        free(seeds);
+    }
+    if (rungs != NULL) {
+        memset(rungs, 0, nsub * sizeof *rungs);
+        free(rungs);
+    }
+    free(leaves);
+
+    return status;
+}
+
+void _get_pkey(unsigned char hash_mode, const struct mss_node auth[MSS_HEIGHT], struct mss_node *node, unsigned char *pkey) {
     unsigned char i, h;
+    mmo_t hash;
 
     for (h = 0; h < MSS_HEIGHT; h++) {
 
@@ -511,14 +946,14 @@ void _get_pkey(const struct mss_node auth[MSS_HEIGHT], struct mss_node *node, un
             assert(_node_brothers(node, &auth[h]));
 #endif
             
-            _get_parent(node, &auth[h], node);
+            _get_parent(&hash, hash_mode, node, &auth[h], node);
         } else {
             
 #if defined(DEBUG) || defined(MSS_SELFTEST)
             assert(_node_brothers(&auth[h], node));
 #endif
             
-            _get_parent(&auth[h], node, node);
+            _get_parent(&hash, hash_mode, &auth[h], node, node);
         }
     }
     
@@ -539,68 +974,299 @@ void _get_pkey(const struct mss_node auth[MSS_HEIGHT], struct mss_node *node, un
 
 /**
  * seed	 The initial seed for generating the private keys
- * v	 The leaf_index-th winternitz public key used as a nonce for the hash H(v,M)
+ * v	 The leaf_index-th winternitz public key, whose hash (the leaf) is used as a nonce for the hash H(Hash(v),M)
  *
  */
 void mss_sign_core(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, const char *data, 
-                   unsigned short datalen, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
+                   size_t datalen, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
                    struct mss_node *node1, struct mss_node *node2,  unsigned char *sig, struct mss_node authpath[MSS_HEIGHT]) {
+    struct mss_iovec iov = { data, datalen };
+
+    mss_sign_core_iov(state, si, ri, leaf, &iov, 1, hash1, h, leaf_index, node1, node2, sig, authpath);
+}
+
+/**
+ * Randomized hash of the message given in iovcnt segments, salted with r
+ */
+static void _etcr_hash_iov(const unsigned char r[NODE_VALUE_SIZE], const struct mss_iovec *iov, unsigned int iovcnt, unsigned char *h) {
+    etcr_t ctx;
+    unsigned int i;
+
+    etcr_init(&ctx, r, NODE_VALUE_SIZE);
+    for (i = 0; i < iovcnt; i++)
+        etcr_update(&ctx, iov[i].base, iov[i].len);
+    etcr_final(&ctx, h);
+}
+
+/**
+ * _etcr_hash_iov of the segments followed by a MSS_RANDOMIZER_SIZE-byte counter, trying the counters 0..attempts-1
+ * and keeping the one whose hash h is the cheapest to verify. The message is hashed once, each attempt only
+ * finalizes a copy of the context.
+ */
+static void _etcr_hash_grind(const unsigned char r[NODE_VALUE_SIZE], const struct mss_iovec *iov, unsigned int iovcnt, 
+                             unsigned int attempts, unsigned char randomizer[MSS_RANDOMIZER_SIZE], unsigned char *h) {
+    etcr_t ctx, trial;
+    unsigned char ctr[MSS_RANDOMIZER_SIZE], th[LEN_BYTES(WINTERNITZ_N)];
+    unsigned int i, a = 0, cost, best = UINT_MAX;
+
+    etcr_init(&ctx, r, NODE_VALUE_SIZE);
+    for (i = 0; i < iovcnt; i++)
+        etcr_update(&ctx, iov[i].base, iov[i].len);
+
+    do {
+        for (i = 0; i < MSS_RANDOMIZER_SIZE; i++)
+            ctr[i] = (unsigned char) (a >> (8 * (MSS_RANDOMIZER_SIZE - 1 - i))); // big endian
+        trial = ctx;
+        etcr_update(&trial, ctr, MSS_RANDOMIZER_SIZE);
+        etcr_final(&trial, th);
+
+        cost = winternitz_verify_cost(th);
+        if (cost < best) {
+            best = cost;
+            memcpy(h, th, LEN_BYTES(WINTERNITZ_N));
+            memcpy(randomizer, ctr, MSS_RANDOMIZER_SIZE);
+        }
+    } while (++a < attempts);
+}
+
+/**
+ * The signature of leaf_index without the traversal step that prepares the next one: the OTS from ri alone or
+ * from the precomputed values in pre when not NULL, with grinding over attempts randomizers when randomizer is
+ * not NULL, and the authentication path.
+ */
+static void _sign_leaf(struct mss_state *state, const unsigned char *ri, const struct mss_presigned *pre, struct mss_node *leaf, 
+                       const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
+                       unsigned char *sig, struct mss_node authpath[MSS_HEIGHT], unsigned int attempts, unsigned char *randomizer) {
     unsigned char i;
-    unsigned char v[NODE_VALUE_SIZE];
- 
+#if WINTERNITZ_CACHE_SPACING
+    const winternitz_cache_t *cached = (pre != NULL) ? &pre->cache : NULL;
+    winternitz_cache_t cache; // the chains walked by keygen, reused by the OTS of a left leaf
+#endif
+
 #if defined(DEBUG) || defined(MSS_SELFTEST)
-    assert((leaf_index >= 0) && (leaf_index < (1 << MSS_HEIGHT)));
+    assert((leaf_index >= 0) && (leaf_index <= LAST_LEAF));
 #endif
     
     //prg(seed, leaf_index, ri);
     //fsgen(seed, seed, ri);
     
-    if (leaf_index % 2 == 0) { // leaf is a left child
+    if (leaf_index % 2 == 0 && pre != NULL) { // left child, computed ahead
+        memcpy(leaf->value, pre->leaf, NODE_VALUE_SIZE);
+    } else if (leaf_index % 2 == 0) { // leaf is a left child
 #ifdef DEBUG
         printf("Calculating leaf %llu in sign. \n", leaf_index);
 #endif
+#if WINTERNITZ_CACHE_SPACING
+        winternitz_keygen_cache(ri, X, leaf->value, &cache); // Compute and store v in leaf->value
+        cached = &cache;
+#else
         winternitz_keygen(ri, X, leaf->value); // Compute and store v in leaf->value
-        memcpy(&v,leaf->value,NODE_VALUE_SIZE);
+#endif
         
-        //MMO_hash16(hash1, leaf->value, leaf->value); 
-        hash32(leaf->value, NODE_VALUE_SIZE, leaf->value); // leaf[leaf_index]->value = Hash(v)
+        _leaf_hash(hash1, state->hash_mode, leaf->value, leaf->value); // leaf[leaf_index]->value = Hash(v)
         
     } else { // leaf is a right child and it is already available in the authentication path
         memcpy(leaf->value, authpath[0].value, NODE_VALUE_SIZE);
-        memcpy(&v,leaf->value,NODE_VALUE_SIZE);        
     }
     leaf->height = 0;
     leaf->index = leaf_index;
 
-    etcr_hash(v,NODE_VALUE_SIZE,data,datalen,h);
-    winternitz_sign(ri, X, h, sig);
+    // The leaf Hash(v) salts the message hash: it travels with the signature, so the verifier has it before the OTS
+    if (randomizer != NULL)
+        _etcr_hash_grind(leaf->value, iov, iovcnt, attempts, randomizer, h);
+    else
+        _etcr_hash_iov(leaf->value, iov, iovcnt, h);
+#if WINTERNITZ_CACHE_SPACING
+    if (cached != NULL)
+        winternitz_sign_cache(cached, X, h, sig);
+    else
+#endif
+        winternitz_sign(ri, X, h, sig);
 
     for (i = 0; i < MSS_HEIGHT; i++) {
         authpath[i].height = state->auth[i].height;
         authpath[i].index = state->auth[i].index;
         memcpy(authpath[i].value, state->auth[i].value, NODE_VALUE_SIZE);
     }
+}
+
+/**
+ * _sign_leaf followed by the traversal step
+ */
+static void _sign_core(struct mss_state *state, unsigned char *si, const unsigned char *ri, const struct mss_presigned *pre, struct mss_node *leaf, 
+                       const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
+                       struct mss_node *node1, struct mss_node *node2, unsigned char *sig, struct mss_node authpath[MSS_HEIGHT],
+                       unsigned int attempts, unsigned char *randomizer) {
+    _sign_leaf(state, ri, pre, leaf, iov, iovcnt, hash1, h, leaf_index, sig, authpath, attempts, randomizer);
 
-    if (leaf_index <= ((unsigned long) 1 << MSS_HEIGHT) - 2)
+    if (leaf_index < LAST_LEAF)
         _nextAuth(state, leaf, si, hash1, node1, node2, leaf_index);
 
 }
 
+/**
+ * The traversal step owed by the last mss_sign_core_deferred, on the snapshot it left
+ */
+static void _deferred_step(struct mss_deferred *d) {
+    _nextAuth(d->state, &d->leaf, d->seed, &d->hash, &d->node1, &d->node2, d->leaf_index);
+}
+
+static void *_deferred_worker(void *arg) {
+    struct mss_deferred *d = arg;
+
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        if (d->pending) {
+            pthread_mutex_unlock(&d->lock);
+            _deferred_step(d);
+            pthread_mutex_lock(&d->lock);
+            d->pending = 0;
+            pthread_cond_broadcast(&d->cond);
+        } else if (d->stop) {
+            break;
+        } else {
+            pthread_cond_wait(&d->cond, &d->lock);
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return NULL;
+}
+
+unsigned char mss_deferred_start(struct mss_deferred *d, struct mss_state *state, int background) {
+    memset(d, 0, sizeof *d);
+    d->state = state;
+    d->background = background;
+    if (!background)
+        return MSS_OK;
+
+    if (pthread_mutex_init(&d->lock, NULL) != 0)
+        return MSS_ERROR;
+    if (pthread_cond_init(&d->cond, NULL) != 0) {
+        pthread_mutex_destroy(&d->lock);
+        return MSS_ERROR;
+    }
+    if (pthread_create(&d->thread, NULL, _deferred_worker, d) != 0) {
+        pthread_cond_destroy(&d->cond);
+        pthread_mutex_destroy(&d->lock);
+        return MSS_ERROR;
+    }
+
+    return MSS_OK;
+}
+
+void mss_deferred_drain(struct mss_deferred *d) {
+    if (!d->background) {
+        if (d->pending) {
+            _deferred_step(d);
+            d->pending = 0;
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    while (d->pending)
+        pthread_cond_wait(&d->cond, &d->lock);
+    pthread_mutex_unlock(&d->lock);
+}
+
+void mss_deferred_stop(struct mss_deferred *d) {
+    if (d->background) {
+        pthread_mutex_lock(&d->lock);
+        d->stop = 1;
+        pthread_cond_broadcast(&d->cond);
+        pthread_mutex_unlock(&d->lock);
+        pthread_join(d->thread, NULL); // the worker finishes the pending step first
+        pthread_cond_destroy(&d->cond);
+        pthread_mutex_destroy(&d->lock);
+    } else {
+        mss_deferred_drain(d);
+    }
+    memset(d->seed, 0, sizeof d->seed);
+}
+
+void mss_sign_core_deferred(struct mss_deferred *d, const unsigned char *si, const unsigned char *ri, struct mss_node *leaf, 
+                            const struct mss_iovec *iov, unsigned int iovcnt, unsigned char *h, uint64_t leaf_index, 
+                            unsigned char *sig, struct mss_node authpath[MSS_HEIGHT]) {
+    mss_deferred_drain(d); // the state must have reached leaf_index
+
+    _sign_leaf(d->state, ri, NULL, leaf, iov, iovcnt, &d->hash, h, leaf_index, sig, authpath, 0, NULL);
+    if (leaf_index >= LAST_LEAF)
+        return; // last leaf, nothing to prepare
+
+    // snapshot what the step reads, the caller moves si on before the next signature
+    d->leaf = *leaf;
+    d->leaf_index = leaf_index;
+    memcpy(d->seed, si, LEN_BYTES(WINTERNITZ_N));
+    if (d->background) {
+        pthread_mutex_lock(&d->lock);
+        d->pending = 1;
+        pthread_cond_broadcast(&d->cond);
+        pthread_mutex_unlock(&d->lock);
+    } else {
+        d->pending = 1;
+    }
+}
+
+void mss_sign_core_iov(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, 
+                       const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
+                       struct mss_node *node1, struct mss_node *node2, unsigned char *sig, struct mss_node authpath[MSS_HEIGHT]) {
+    _sign_core(state, si, ri, NULL, leaf, iov, iovcnt, hash1, h, leaf_index, node1, node2, sig, authpath, 0, NULL);
+}
+
+void mss_sign_core_grind(struct mss_state *state, unsigned char *si, unsigned char *ri, struct mss_node *leaf, 
+                         const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, uint64_t leaf_index, 
+                         struct mss_node *node1, struct mss_node *node2, unsigned char *sig, struct mss_node authpath[MSS_HEIGHT],
+                         unsigned int attempts, unsigned char randomizer[MSS_RANDOMIZER_SIZE]) {
+    _sign_core(state, si, ri, NULL, leaf, iov, iovcnt, hash1, h, leaf_index, node1, node2, sig, authpath, attempts, randomizer);
+}
+
+void mss_sign_core_presigned(struct mss_state *state, unsigned char *si, const struct mss_presigned *pre, struct mss_node *leaf, 
+                             const struct mss_iovec *iov, unsigned int iovcnt, mmo_t *hash1, unsigned char *h, 
+                             struct mss_node *node1, struct mss_node *node2, unsigned char *sig, struct mss_node authpath[MSS_HEIGHT]) {
+    _sign_core(state, si, pre->ri, pre, leaf, iov, iovcnt, hash1, h, pre->index, node1, node2, sig, authpath, 0, NULL);
+}
+
+void mss_presign_leaf(unsigned char hash_mode, uint64_t leaf_index, const unsigned char ri[LEN_BYTES(WINTERNITZ_N)], struct mss_presigned *pre) {
+    mmo_t hash;
+
+    pre->index = leaf_index;
+    memcpy(pre->ri, ri, LEN_BYTES(WINTERNITZ_N));
+#if WINTERNITZ_CACHE_SPACING
+    winternitz_keygen_cache(ri, X, pre->leaf, &pre->cache);
+#else
+    winternitz_keygen(ri, X, pre->leaf);
+#endif
+    _leaf_hash(&hash, hash_mode, pre->leaf, pre->leaf);
+}
+
 /**
  * s	 The leaf_index-th Winternitz private key
- * v	 The leaf_index-th Winternitz public key used as a nonce for the hash H(v,M)
+ * v	 The leaf_index-th Winternitz public key, whose hash (the leaf) is used as a nonce for the hash H(Hash(v),M)
  *
  */
-unsigned char mss_verify_core(struct mss_node authpath[MSS_HEIGHT], const char *data, unsigned short datalen, 
+unsigned char mss_verify_core(struct mss_node authpath[MSS_HEIGHT], const char *data, size_t datalen, 
                               unsigned char *h, uint64_t leaf_index, const unsigned char *sig, 
-                              unsigned char *x, struct mss_node *currentLeaf, const unsigned char *Y) {
+                              unsigned char *x, struct mss_node *currentLeaf, const unsigned char Y[NODE_VALUE_SIZE], unsigned char hash_mode) {
+    struct mss_iovec iov = { data, datalen };
+
+    return mss_verify_core_iov(authpath, &iov, 1, h, leaf_index, sig, x, currentLeaf, Y, hash_mode);
+}
+
+unsigned char mss_verify_core_iov(struct mss_node authpath[MSS_HEIGHT], const struct mss_iovec *iov, unsigned int iovcnt, 
+                                  unsigned char *h, uint64_t leaf_index, const unsigned char *sig, 
+                                  unsigned char *x, struct mss_node *currentLeaf, const unsigned char Y[NODE_VALUE_SIZE], unsigned char hash_mode) {
+    mmo_t hash;
+
+    _etcr_hash_iov(currentLeaf->value, iov, iovcnt, h); // salted with the leaf, as in mss_sign_core_iov
+
     winternitz_verify(x, X, h, sig, x); // x <- v
-    
-    etcr_hash(x, NODE_VALUE_SIZE, data, datalen,h);
 
-    hash32(x, NODE_VALUE_SIZE, x); // x <- leaf = Hash(v)
+    _leaf_hash(&hash, hash_mode, x, x); // x <- leaf = Hash(v)
 
-    _get_pkey(authpath, currentLeaf, x);
+    // Climb from the recomputed leaf, so that both the OTS and the message are checked against the root
+    memcpy(currentLeaf->value, x, NODE_VALUE_SIZE);
+    _get_pkey(hash_mode, authpath, currentLeaf, x);
 
     if (memcmp(currentLeaf->value, Y, NODE_VALUE_SIZE) == 0) {
         
@@ -616,7 +1282,11 @@ unsigned char mss_verify_core(struct mss_node authpath[MSS_HEIGHT], const char *
 
 #ifdef SERIALIZATION
 
-unsigned char *mss_keygen(const unsigned char seed[LEN_BYTES(MSS_SEC_LVL)]) {
+unsigned char *mss_keygen(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)]) {
+    return mss_keygen_mode(seed, MSS_HASH_SHA256);
+}
+
+unsigned char *mss_keygen_mode(const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], unsigned char hash_mode) {
 
     unsigned short i;
     unsigned char *keys = malloc(MSS_SKEY_SIZE + MSS_PKEY_SIZE);
@@ -625,7 +1295,9 @@ unsigned char *mss_keygen(const unsigned char seed[LEN_BYTES(MSS_SEC_LVL)]) {
     struct mss_state state;
     mmo_t hash1, hash2;
 
-    mss_keygen_core(&hash1, &hash2, seed, &node[0], &node[1], &state, pkey);
+    memset(&state, 0, sizeof state); // the unused stack and store slots are serialized too
+    mss_keygen_core(&hash1, &hash2, seed, &node[0], &node[1], &state, pkey, hash_mode);
+    pkey[NODE_VALUE_SIZE] = hash_mode;
     serialize_mss_skey(state, 0, seed, keys);
 
     for (i = 0; i < MSS_PKEY_SIZE; i++)
@@ -647,21 +1319,27 @@ unsigned char *mss_sign(unsigned char skey[MSS_SKEY_SIZE], const unsigned char d
     struct mss_state state;
     struct mss_node authpath[MSS_HEIGHT];
 
-    unsigned char ri[LEN_BYTES(MSS_SEC_LVL)];
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned char randomizer[MSS_RANDOMIZER_SIZE];
+    struct mss_iovec iov = { digest, 2 * LEN_BYTES(MSS_SEC_LVL) };
 
-    unsigned char *signature = malloc(MSS_SIGNATURE_SIZE);
+    unsigned char *signature = calloc(1, MSS_SIGNATURE_SIZE); // serialize_mss_node leaves the end of each MSS_NODE_SIZE slot
 
-    deserialize_mss_skey(&state, &index, ri, skey);
+    deserialize_mss_skey(&state, &index, si, skey);
 
-    mss_sign_core(&state, skey, ri, &node[0], (char *) digest, 2 * LEN_BYTES(MSS_SEC_LVL), &hash1, hash, index, &node[1], &node[2], ots, authpath);
+    fsgen(si, si, ri); // (si, ri) <- the next seed and the WOTS seed of leaf index
+    // a right leaf is taken from authpath[0], which only the previous signature left filled in: recompute it
+    if (index % 2 == 1)
+        _create_leaf(&hash1, state.hash_mode, &authpath[0], index, ri);
+    mss_sign_core_grind(&state, si, ri, &node[0], &iov, 1, &hash1, hash, index, &node[1], &node[2], ots, authpath, MSS_GRIND_ATTEMPTS, randomizer);
     index++;
 
-    serialize_mss_skey(state, index, ri, skey);
+    serialize_mss_skey(state, index, si, skey);
     //printf(">>>>>>>>>>skey\n%d\n", MSS_SKEY_SIZE);
     //unsigned int i;
     //for(i=0; i < MSS_SKEY_SIZE; i++)
     //		printf("%02X", skey[i]);
-    serialize_mss_signature(ots, node[0], authpath, signature);
+    serialize_mss_signature(ots, node[0], authpath, randomizer, signature);
 
     return signature;
     
@@ -679,14 +1357,276 @@ unsigned char mss_verify(const unsigned char signature[MSS_SIGNATURE_SIZE], cons
     /* Merkle-tree variables */
     struct mss_node authpath[MSS_HEIGHT];
 
-    deserialize_mss_signature(ots, &v, authpath, signature);
+    unsigned char randomizer[MSS_RANDOMIZER_SIZE];
+    struct mss_iovec iov[2] = { { digest, 2 * LEN_BYTES(MSS_SEC_LVL) }, { randomizer, MSS_RANDOMIZER_SIZE } };
+
+    deserialize_mss_signature(ots, &v, authpath, randomizer, signature);
 
-    verification = mss_verify_core(authpath, (char *) digest, 2 * LEN_BYTES(MSS_SEC_LVL), hash, v.index, ots, aux, &v, pkey);
+    verification = mss_verify_core_iov(authpath, iov, 2, hash, v.index, ots, aux, &v, pkey, pkey[NODE_VALUE_SIZE]);
 
     return verification;
     
 }
 
+/**
+ * Leaf of the tree of layer l used by the hypertree leaf index
+ */
+static uint64_t _hypertree_leaf(uint64_t index, unsigned int l) {
+    return (index >> (MSS_HEIGHT * l)) & (~(uint64_t) 0 >> (64 - MSS_HEIGHT));
+}
+
+/**
+ * Generate the first tree of layer l as the current one of that layer, and its root
+ */
+static void _hypertree_tree(struct mss_hypertree *ht, unsigned int l, unsigned char root[NODE_VALUE_SIZE]) {
+    struct mss_node node[2];
+    mmo_t hash1, hash2;
+
+    fsgen(ht->chain[l], ht->chain[l], ht->si[l]); // the tree seed, from which the next fsgen gives the WOTS seed of leaf 0
+    mss_keygen_core(&hash1, &hash2, ht->si[l], &node[0], &node[1], &ht->state[l], root, ht->hash_mode);
+    memset(ht->authpath[l], 0, sizeof ht->authpath[l]);
+}
+
+/**
+ * Start the next tree of layer l from the next seed of the chain of the layer
+ */
+static void _hypertree_next_init(struct mss_hypertree *ht, unsigned int l) {
+    fsgen(ht->chain[l], ht->chain[l], ht->next_seed[l]);
+    memcpy(ht->next_si[l], ht->next_seed[l], LEN_BYTES(WINTERNITZ_N));
+    init_state(&ht->next[l]);
+    ht->next[l].hash_mode = ht->hash_mode;
+    ht->next_leaf[l] = 0;
+    ht->next_keep[l] = 0;
+}
+
+/**
+ * Add one leaf to the next tree of layer l, as mss_keygen_core would
+ */
+static void _hypertree_next_step(struct mss_hypertree *ht, unsigned int l) {
+    struct mss_node node[2];
+    mmo_t hash1;
+
+    _keygen_leaf(&hash1, ht->hash_mode, &ht->next[l], ht->next_leaf[l], ht->next_si[l], &ht->next_keep[l], &node[0], &node[1]);
+    ht->next_leaf[l]++;
+    if (_hypertree_leaf(ht->next_leaf[l], 0) == 0) { // the last leaf: node[0] is the root
+        memcpy(ht->next_root[l], node[0].value, NODE_VALUE_SIZE);
+        memset(ht->next_si[l], 0, LEN_BYTES(WINTERNITZ_N));
+    }
+}
+
+/**
+ * Make the completed next tree of layer l the current one, give its root, and start the one after it
+ */
+static void _hypertree_next_swap(struct mss_hypertree *ht, unsigned int l, unsigned char root[NODE_VALUE_SIZE]) {
+#ifdef DEBUG
+    assert(ht->next_leaf[l] != 0 && _hypertree_leaf(ht->next_leaf[l], 0) == 0);
+#endif
+    ht->state[l] = ht->next[l];
+    memcpy(ht->si[l], ht->next_seed[l], LEN_BYTES(WINTERNITZ_N));
+    memcpy(root, ht->next_root[l], NODE_VALUE_SIZE);
+    memset(ht->authpath[l], 0, sizeof ht->authpath[l]);
+    _hypertree_next_init(ht, l);
+}
+
+/**
+ * Sign msg with leaf leaf_index of the current tree of layer l, as mss_sign
+ */
+static void _hypertree_sign_layer(struct mss_hypertree *ht, unsigned int l, uint64_t leaf_index, const unsigned char msg[NODE_VALUE_SIZE], unsigned char signature[MSS_SIGNATURE_SIZE]) {
+    struct mss_node node[3];
+    struct mss_iovec iov = { msg, NODE_VALUE_SIZE };
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)], hash[LEN_BYTES(WINTERNITZ_N)], ots[MSS_OTS_SIZE], randomizer[MSS_RANDOMIZER_SIZE];
+    mmo_t hash1;
+
+    fsgen(ht->si[l], ht->si[l], ri);
+    mss_sign_core_grind(&ht->state[l], ht->si[l], ri, &node[0], &iov, 1, &hash1, hash, leaf_index, &node[1], &node[2], ots, ht->authpath[l], MSS_GRIND_ATTEMPTS, randomizer);
+    memset(signature, 0, MSS_SIGNATURE_SIZE); // serialize_mss_node leaves the end of each MSS_NODE_SIZE slot
+    serialize_mss_signature(ots, node[0], ht->authpath[l], randomizer, signature);
+    memset(ri, 0, sizeof ri);
+}
+
+void mss_hypertree_keygen(struct mss_hypertree *ht, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], unsigned char pkey[MSS_PKEY_SIZE], unsigned char hash_mode) {
+    unsigned char root[MSS_LAYERS][NODE_VALUE_SIZE];
+    unsigned int l;
+
+    memset(ht, 0, sizeof *ht);
+    ht->hash_mode = hash_mode;
+
+    for (l = 0; l < MSS_LAYERS; l++) {
+        prg(seed, l, ht->chain[l]);
+        _hypertree_tree(ht, l, root[l]);
+    }
+    for (l = 0; l + 1 < MSS_LAYERS; l++)
+        _hypertree_next_init(ht, l);
+    for (l = 1; l < MSS_LAYERS; l++)
+        _hypertree_sign_layer(ht, l, 0, root[l - 1], ht->sig[l]);
+
+    memcpy(pkey, root[MSS_LAYERS - 1], NODE_VALUE_SIZE);
+    pkey[NODE_VALUE_SIZE] = hash_mode;
+}
+
+unsigned char mss_hypertree_sign(struct mss_hypertree *ht, const unsigned char digest[NODE_VALUE_SIZE], unsigned char signature[MSS_HT_SIGNATURE_SIZE]) {
+    unsigned char root[NODE_VALUE_SIZE];
+    unsigned int i, l, z;
+
+#if MSS_LAYERS * MSS_HEIGHT < 64
+    if (ht->index >> (MSS_LAYERS * MSS_HEIGHT))
+        return MSS_ERROR;
+#endif
+    for (i = 0; i < 8; i++)
+        signature[i] = (unsigned char) (ht->index >> (8 * i));
+    _hypertree_sign_layer(ht, 0, _hypertree_leaf(ht->index, 0), digest, signature + 8);
+    for (l = 1; l < MSS_LAYERS; l++)
+        memcpy(signature + 8 + l * MSS_SIGNATURE_SIZE, ht->sig[l], MSS_SIGNATURE_SIZE);
+
+    // Each layer below the top adds a leaf to its next tree whenever the layer below starts a tree, if the
+    // current tree is not the last one of the layer: 2^MSS_HEIGHT leaves over the life of the current tree
+    for (l = 0; l + 1 < MSS_LAYERS; l++)
+        if ((ht->index & (((uint64_t) 1 << (MSS_HEIGHT * l)) - 1)) == 0
+            && ((ht->index >> (MSS_HEIGHT * (l + 1))) + 1) >> (MSS_HEIGHT * (MSS_LAYERS - 1 - l)) == 0)
+            _hypertree_next_step(ht, l);
+    ht->index++;
+
+#if MSS_LAYERS * MSS_HEIGHT < 64
+    if (ht->index >> (MSS_LAYERS * MSS_HEIGHT))
+        return MSS_OK;
+#else
+    if (ht->index == 0)
+        return MSS_OK;
+#endif
+    // The trees of layers 0..z-1 have no leaf left: replace them by their next trees from the highest one down,
+    // the root of each new tree being signed by the next leaf of the layer above
+    for (z = 0; z < MSS_LAYERS - 1 && _hypertree_leaf(ht->index, z) == 0; z++)
+        ;
+    for (l = z; l-- > 0;) {
+        _hypertree_next_swap(ht, l, root);
+        _hypertree_sign_layer(ht, l + 1, _hypertree_leaf(ht->index, l + 1), root, ht->sig[l + 1]);
+    }
+
+    return MSS_OK;
+}
+
+unsigned char mss_hypertree_verify(const unsigned char signature[MSS_HT_SIGNATURE_SIZE], const unsigned char pkey[MSS_PKEY_SIZE], const unsigned char digest[NODE_VALUE_SIZE]) {
+    struct mss_node v, authpath[MSS_HEIGHT];
+    unsigned char ots[MSS_OTS_SIZE], randomizer[MSS_RANDOMIZER_SIZE], root[NODE_VALUE_SIZE];
+    unsigned char hash[LEN_BYTES(WINTERNITZ_N)], aux[LEN_BYTES(WINTERNITZ_N)];
+    struct mss_iovec iov[2] = { { root, NODE_VALUE_SIZE }, { randomizer, MSS_RANDOMIZER_SIZE } };
+    uint64_t index = 0;
+    unsigned int i, l;
+
+    for (i = 0; i < 8; i++)
+        index |= (uint64_t) signature[i] << (8 * i);
+#if MSS_LAYERS * MSS_HEIGHT < 64
+    if (index >> (MSS_LAYERS * MSS_HEIGHT))
+        return MSS_ERROR;
+#endif
+
+    // Climb the layers: the root recomputed from the signature of layer l is the message of layer l+1,
+    // and the one of the top layer must be the public key
+    memcpy(root, digest, NODE_VALUE_SIZE);
+    for (l = 0; l < MSS_LAYERS; l++) {
+        deserialize_mss_signature(ots, &v, authpath, randomizer, signature + 8 + l * MSS_SIGNATURE_SIZE);
+        if (v.index != _hypertree_leaf(index, l))
+            return MSS_ERROR;
+        if (mss_verify_core_iov(authpath, iov, 2, hash, v.index, ots, aux, &v, pkey, pkey[NODE_VALUE_SIZE]) == MSS_OK)
+            return (l == MSS_LAYERS - 1) ? MSS_OK : MSS_ERROR;
+        memcpy(root, v.value, NODE_VALUE_SIZE); // mss_verify_core_iov left the root in v
+    }
+
+    return MSS_ERROR;
+}
+
+void mss_verify_stream_init(struct mss_verify_stream *vs, const unsigned char pkey[MSS_PKEY_SIZE], const unsigned char digest[2 * LEN_BYTES(MSS_SEC_LVL)]) {
+    memset(vs, 0, sizeof *vs);
+    vs->pkey = pkey;
+    vs->digest = digest;
+    vs->status = MSS_OK;
+}
+
+/**
+ * Handle the field of the signature which ends at offset pos, now complete in vs->buf
+ */
+static void _verify_stream_field(struct mss_verify_stream *vs, size_t pos) {
+    unsigned char hash_mode = vs->pkey[NODE_VALUE_SIZE], h[LEN_BYTES(WINTERNITZ_N)];
+    struct mss_iovec iov[2] = { { vs->digest, 2 * LEN_BYTES(MSS_SEC_LVL) }, { vs->buf, MSS_RANDOMIZER_SIZE } };
+    struct mss_node auth;
+    mmo_t hash;
+
+    if (pos == MSS_NODE_SIZE) {
+        deserialize_mss_node(&vs->node, vs->buf); // v, whose value salts the message hash
+    } else if (pos == MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE) {
+        _etcr_hash_iov(vs->node.value, iov, 2, h);
+        winternitz_verify_init(&vs->ots, X, h);
+    } else if (pos == MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE + MSS_OTS_SIZE) {
+        if (winternitz_verify_final(&vs->ots, vs->node.value) != WINTERNITZ_OK) {
+            vs->status = MSS_ERROR;
+            return;
+        }
+        _leaf_hash(&hash, hash_mode, vs->node.value, vs->node.value); // leaf = Hash(v), climbed by the next fields
+        vs->node.height = 0;
+    } else {
+        // the next authentication node, folded as in _get_pkey
+        deserialize_mss_node(&auth, vs->buf);
+        if (auth.height != vs->node.height) {
+            vs->status = MSS_ERROR;
+            return;
+        }
+        if (auth.index >= vs->node.index)
+            _get_parent(&hash, hash_mode, &vs->node, &auth, &vs->node);
+        else
+            _get_parent(&hash, hash_mode, &auth, &vs->node, &vs->node);
+    }
+}
+
+unsigned char mss_verify_stream_update(struct mss_verify_stream *vs, const unsigned char *data, size_t len) {
+    const size_t ots_start = MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE, ots_end = ots_start + MSS_OTS_SIZE;
+    size_t end, c;
+
+    if (vs->status != MSS_OK || len > MSS_SIGNATURE_SIZE - vs->pos)
+        return (vs->status = MSS_ERROR);
+
+    while (len > 0) {
+        // end of the field holding vs->pos
+        if (vs->pos < MSS_NODE_SIZE)
+            end = MSS_NODE_SIZE;
+        else if (vs->pos < ots_start)
+            end = ots_start;
+        else if (vs->pos < ots_end)
+            end = ots_end;
+        else
+            end = vs->pos + MSS_NODE_SIZE - (vs->pos - ots_end) % MSS_NODE_SIZE;
+
+        c = (len < end - vs->pos) ? len : end - vs->pos;
+        if (vs->pos >= ots_start && vs->pos < ots_end)
+            winternitz_verify_update(&vs->ots, data, c); // the OTS is not buffered, its chains are completed right away
+        else {
+            memcpy(vs->buf + vs->buf_len, data, c);
+            vs->buf_len += c;
+        }
+        vs->pos += c;
+        data += c;
+        len -= c;
+
+        if (vs->pos == end) {
+            _verify_stream_field(vs, end);
+            vs->buf_len = 0;
+            if (vs->status != MSS_OK)
+                return MSS_ERROR;
+        }
+    }
+
+    return MSS_OK;
+}
+
+unsigned char mss_verify_stream_final(struct mss_verify_stream *vs) {
+    unsigned char verification = MSS_ERROR;
+
+    if (vs->status == MSS_OK && vs->pos == MSS_SIGNATURE_SIZE && memcmp(vs->node.value, vs->pkey, NODE_VALUE_SIZE) == 0)
+        verification = MSS_OK;
+    memset(vs, 0, sizeof *vs);
+
+    return verification;
+}
+
 
 /***************************************************************************************************/
 /* Serialization/Deserialization																   */
@@ -716,10 +1656,11 @@ void deserialize_mss_node(struct mss_node *node, const unsigned char buffer[]) {
 }
 
 void serialize_mss_state(const struct mss_state state, const uint64_t index, unsigned char buffer[MSS_STATE_SIZE]) {
-    unsigned int i, offset = 0;
+    unsigned int i, j, offset = 0;
 
     buffer[offset++] = index & 0xFF;
     buffer[offset++] = (index >> 8) & 0xFF;
+    buffer[offset++] = state.hash_mode;
 
     for (i = 0; i < MSS_TREEHASH_SIZE; i++)
         buffer[offset++] = state.treehash_state[i];
@@ -737,6 +1678,23 @@ void serialize_mss_state(const struct mss_state state, const uint64_t index, uns
         buffer[offset++] = (state.treehash_seed[i] >> 8) & 0xFF;
     }
 
+    for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
+        for (j = 0; j < 8; j++)
+            buffer[offset++] = (state.ladder_index[i] >> (8 * j)) & 0xFF;
+        for (j = 0; j < LEN_BYTES(WINTERNITZ_N); j++)
+            buffer[offset++] = state.ladder[i][j];
+    }
+
+    for (j = 0; j < 8; j++)
+        buffer[offset++] = (state.budget >> (8 * j)) & 0xFF;
+
+    for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
+        for (j = 0; j < 8; j++)
+            buffer[offset++] = (state.rung_index[i] >> (8 * j)) & 0xFF;
+        for (j = 0; j < LEN_BYTES(WINTERNITZ_N); j++)
+            buffer[offset++] = state.rung[i][j];
+    }
+
     for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
         serialize_mss_node(state.treehash[i], buffer + offset);
         offset += MSS_NODE_SIZE;
@@ -769,10 +1727,11 @@ void serialize_mss_state(const struct mss_state state, const uint64_t index, uns
 }
 
 void deserialize_mss_state(struct mss_state *state, uint64_t *index, const unsigned char buffer[]) {
-    int i, offset = 0;
+    int i, j, offset = 0;
 
     *index = (buffer[offset++] & 0xFF);
     *index = *index | (buffer[offset++] << 8);
+    state->hash_mode = buffer[offset++];
 
     for (i = 0; i < MSS_TREEHASH_SIZE; i++)
         state->treehash_state[i] = buffer[offset++];
@@ -781,13 +1740,38 @@ void deserialize_mss_state(struct mss_state *state, uint64_t *index, const unsig
     state->stack_index = state->stack_index | (buffer[offset++] << 8);
 
 
-    for (i = 0; i < MSS_K - 1; i++)
+    for (i = 0; i < MSS_K - 1; i++) {
         state->retain_index[i] = (buffer[offset++] & 0xFF);
-    state->retain_index[i] = state->retain_index[i] | (buffer[offset++] << 8);
+        state->retain_index[i] = state->retain_index[i] | (buffer[offset++] << 8);
+    }
 
-    for (i = 0; i < MSS_TREEHASH_SIZE; i++)
+    for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
         state->treehash_seed[i] = (buffer[offset++] & 0xFF);
-    state->treehash_seed[i] = state->treehash_seed[i] | (buffer[offset++] << 8);
+        state->treehash_seed[i] = state->treehash_seed[i] | (buffer[offset++] << 8);
+    }
+
+    for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
+        state->ladder_index[i] = 0;
+        for (j = 0; j < 8; j++)
+            state->ladder_index[i] |= (uint64_t) buffer[offset++] << (8 * j);
+        for (j = 0; j < LEN_BYTES(WINTERNITZ_N); j++)
+            state->ladder[i][j] = buffer[offset++];
+    }
+
+    state->budget = 0;
+    for (j = 0; j < 8; j++)
+        state->budget |= (uint64_t) buffer[offset++] << (8 * j);
+    state->work = 0;
+    memset(state->ahead, 0, sizeof state->ahead); // the prefetched leaves are not serialized
+    state->leaves = NULL;
+
+    for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
+        state->rung_index[i] = 0;
+        for (j = 0; j < 8; j++)
+            state->rung_index[i] |= (uint64_t) buffer[offset++] << (8 * j);
+        for (j = 0; j < LEN_BYTES(WINTERNITZ_N); j++)
+            state->rung[i][j] = buffer[offset++];
+    }
 
     for (i = 0; i < MSS_TREEHASH_SIZE; i++) {
         deserialize_mss_node(&state->treehash[i], buffer + offset);
@@ -820,56 +1804,62 @@ void deserialize_mss_state(struct mss_state *state, uint64_t *index, const unsig
     }
 }
 
-void serialize_mss_skey(const struct mss_state state, const uint64_t index, const unsigned char skey[LEN_BYTES(MSS_SEC_LVL)], unsigned char buffer[MSS_SKEY_SIZE]) {
+void serialize_mss_skey(const struct mss_state state, const uint64_t index, const unsigned char skey[LEN_BYTES(WINTERNITZ_N)], unsigned char buffer[MSS_SKEY_SIZE]) {
     serialize_mss_state(state, index, buffer);
 
     unsigned int offset = MSS_STATE_SIZE, i;
 
-    for (i = 0; i < LEN_BYTES(MSS_SEC_LVL); i++)
+    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++)
         buffer[offset++] = skey[i];
 }
 
-void deserialize_mss_skey(struct mss_state *state, uint64_t *index, unsigned char skey[LEN_BYTES(MSS_SEC_LVL)], const unsigned char buffer[]) {
+void deserialize_mss_skey(struct mss_state *state, uint64_t *index, unsigned char skey[LEN_BYTES(WINTERNITZ_N)], const unsigned char buffer[]) {
     deserialize_mss_state(state, index, buffer);
 
     unsigned int offset = MSS_STATE_SIZE, i;
 
-    for (i = 0; i < LEN_BYTES(MSS_SEC_LVL); i++)
+    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++)
         skey[i] = buffer[offset++];
 }
 
-void serialize_mss_signature(const unsigned char ots[MSS_OTS_SIZE], const struct mss_node v, const struct mss_node authpath[MSS_HEIGHT], unsigned char *buffer) {
+void serialize_mss_signature(const unsigned char ots[MSS_OTS_SIZE], const struct mss_node v, const struct mss_node authpath[MSS_HEIGHT], const unsigned char randomizer[MSS_RANDOMIZER_SIZE], unsigned char buffer[MSS_SIGNATURE_SIZE]) {
     /*
-     * Serialization: v || authpath || ots
-     *
+     * Serialization: v || randomizer || ots || authpath
+     * in the order a verifier uses them, see mss_verify_stream_update
      */
     unsigned int i, offset = 0;
 
     serialize_mss_node(v, buffer);
     offset += MSS_NODE_SIZE;
 
+    for (i = 0; i < MSS_RANDOMIZER_SIZE; i++)
+        buffer[offset++] = randomizer[i];
+
+    for (i = 0; i < MSS_OTS_SIZE; i++)
+        buffer[offset++] = ots[i];
+
     for (i = 0; i < MSS_HEIGHT; i++) {
         serialize_mss_node(authpath[i], buffer + offset);
         offset += MSS_NODE_SIZE;
     }
-
-    for (i = 0; i < MSS_OTS_SIZE; i++)
-        buffer[offset++] = ots[i];
 }
 
-void deserialize_mss_signature(unsigned char ots[MSS_OTS_SIZE], struct mss_node *v, struct mss_node authpath[MSS_HEIGHT], const unsigned char *signature) {
+void deserialize_mss_signature(unsigned char ots[MSS_OTS_SIZE], struct mss_node *v, struct mss_node authpath[MSS_HEIGHT], unsigned char randomizer[MSS_RANDOMIZER_SIZE], const unsigned char *signature) {
     int i, offset = 0;
 
     deserialize_mss_node(v, signature);
     offset += MSS_NODE_SIZE;
 
+    for (i = 0; i < MSS_RANDOMIZER_SIZE; i++)
+        randomizer[i] = signature[offset++];
+
+    for (i = 0; i < MSS_OTS_SIZE; i++)
+        ots[i] = signature[offset++];
+
     for (i = 0; i < MSS_HEIGHT; i++) {
         deserialize_mss_node(&authpath[i], signature + offset);
         offset += MSS_NODE_SIZE;
     }
-
-    for (i = 0; i < MSS_OTS_SIZE; i++)
-        ots[i] = signature[offset++];
 }
 
 #endif // serialization/deserialization methods
@@ -882,7 +1872,7 @@ unsigned char _node_valid_index(const unsigned char height, const uint64_t pos)
     
     if (height >= 0 && height <= MSS_HEIGHT) {
         valid_height = 1;
-        if (pos < (1 << (MSS_HEIGHT - height)))
+        if (pos < ((uint64_t) 1 << (MSS_HEIGHT - height)))
             valid_pos = 1;
     }
     return (valid_height && valid_pos);
@@ -955,7 +1945,7 @@ void print_stack(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned shor
     
 }
 
-void print_stack_push(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned short top, const struct mss_node node, const unsigned char pre_condition) {
+void print_stack_push(const struct mss_node *stack, const unsigned short top, const struct mss_node node, const unsigned char pre_condition) {
     if (pre_condition) {
         printf("----- _stack_push -----\n\n");
         printf("Stack before push:");
@@ -970,7 +1960,7 @@ void print_stack_push(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned
     
 }
 
-void print_stack_pop(const struct mss_node stack[MSS_KEEP_SIZE], const unsigned short top, const unsigned char pre_condition) {
+void print_stack_pop(const struct mss_node *stack, const unsigned short top, const unsigned char pre_condition) {
     if (pre_condition) {
         printf("----- _stack_pop -----\n\n");
         printf("Stack before pop:");
@@ -1066,18 +2056,18 @@ int main(int argc, char *argv[]) {
     printf("\nParameters:  WINTERNITZ_n=%u, Tree_Height=%u, Treehash_K=%u, WINTERNITZ_w=%u \n\n", MSS_SEC_LVL, MSS_HEIGHT, MSS_K, WINTERNITZ_W);
 
     // Execution variables
-    unsigned char seed[LEN_BYTES(MSS_SEC_LVL)] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF};
+    unsigned char seed[LEN_BYTES(WINTERNITZ_N)];
     unsigned char skey[MSS_SKEY_SIZE], pkey[MSS_PKEY_SIZE], *key_pair, signature[MSS_SIGNATURE_SIZE];
     char msg[] = "Hello, world!";
 
     unsigned short j;
     srand(time(NULL));
 
-    for (j = 0; j < LEN_BYTES(MSS_SEC_LVL); j++) {
+    for (j = 0; j < LEN_BYTES(WINTERNITZ_N); j++) {
         seed[j] = rand() ^ j; // sample private key, this is not a secure, only for tests!
     }
 
-    Display("seed for keygen: ", seed, LEN_BYTES(MSS_SEC_LVL));
+    Display("seed for keygen: ", seed, LEN_BYTES(WINTERNITZ_N));
 
     printf("Key generation... ");
     key_pair = mss_keygen(seed);
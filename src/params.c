@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "params.h"
+
+// MSS_PROFILE_LIST is set by the makefile from MSS_PROFILES, e.g. P(10_2_2) P(16_4_4)
+#ifndef MSS_PROFILE_LIST
+#define MSS_PROFILE_LIST
+#endif
+
+#define P(name) extern const struct mss_params mss_params_##name;
+MSS_PROFILE_LIST
+#undef P
+
+#define P(name) &mss_params_##name,
+const struct mss_params *const mss_profiles[] = { MSS_PROFILE_LIST NULL };
+#undef P
+
+const struct mss_params *mss_params_find(unsigned int height, unsigned int k, unsigned int w) {
+    unsigned int i;
+
+    for (i = 0; mss_profiles[i] != NULL; i++)
+        if (mss_profiles[i]->height == height && mss_profiles[i]->k == k && mss_profiles[i]->w == w)
+            return mss_profiles[i];
+
+    return NULL;
+}
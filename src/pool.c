@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The chain pool of winternitz_pool_start. It only runs prg32 chains, which do not depend on WINTERNITZ_W, so it
+ * lives outside winternitz.c: the default build and every profile of params.h share this one pool.
+ */
+
+#include <pthread.h>
+
+#include "winternitz.h"
+
+/**
+ * The chain pool: each job is dealt into parts, part 0 is run by the submitting thread and part k by worker k-1.
+ * busy is held by the thread whose job is in flight, and by start and stop while they change the workers, so that
+ * a job is only dealt to running workers; lock guards the job and the counters.
+ */
+static struct {
+    pthread_mutex_t busy, lock;
+    pthread_cond_t start, done;
+    pthread_t worker[WINTERNITZ_POOL_MAX - 1];
+    unsigned int workers;               // running workers, 0 when the pool is stopped or started with one thread
+    int running;                        // between winternitz_pool_start and winternitz_pool_stop
+    unsigned int generation;            // incremented for each job, reset by winternitz_pool_start
+    unsigned int pending;               // workers still on the current job
+    int stop;
+    const unsigned char *X;
+    unsigned char *chain[WINTERNITZ_POOL_MAX][WINTERNITZ_MAX_L];
+    unsigned int steps[WINTERNITZ_POOL_MAX][WINTERNITZ_MAX_L];
+    unsigned int n[WINTERNITZ_POOL_MAX];
+} _pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+/**
+ * chain[i] = F^steps[i](chain[i]) on the calling thread
+ */
+static void _chains_run(unsigned char *const chain[], const unsigned char *X, const unsigned int steps[], unsigned int n) {
+    unsigned int i;
+
+    for (i = 1; i < n && steps[i] == steps[0]; i++)
+        ;
+    if (i >= n) // keygen: one length, no scheduling needed
+        prg32_chain_x(chain, X, n ? steps[0] : 0, n);
+    else
+        prg32_chains_x(chain, X, steps, n);
+}
+
+static void _pool_run(unsigned int part) {
+    _chains_run(_pool.chain[part], _pool.X, _pool.steps[part], _pool.n[part]);
+}
+
+static void *_pool_worker(void *arg) {
+    unsigned int part = (unsigned int) (size_t) arg, seen = 0;
+
+    pthread_mutex_lock(&_pool.lock);
+    for (;;) {
+        while (_pool.generation == seen && !_pool.stop)
+            pthread_cond_wait(&_pool.start, &_pool.lock);
+        if (_pool.stop)
+            break;
+        seen = _pool.generation;
+        pthread_mutex_unlock(&_pool.lock);
+
+        _pool_run(part);
+
+        pthread_mutex_lock(&_pool.lock);
+        if (--_pool.pending == 0)
+            pthread_cond_signal(&_pool.done);
+    }
+    pthread_mutex_unlock(&_pool.lock);
+
+    return NULL;
+}
+
+unsigned char winternitz_pool_start(unsigned int threads) {
+    unsigned int k;
+
+    if (threads == 0 || threads > WINTERNITZ_POOL_MAX || _pool.running)
+        return WINTERNITZ_ERROR;
+
+    // new workers start from generation 0, so the last job of a previous pool must not look pending
+    _pool.stop = 0;
+    _pool.generation = 0;
+    _pool.pending = 0;
+    _pool.running = 1;
+    for (k = 0; k + 1 < threads; k++)
+        if (pthread_create(&_pool.worker[k], NULL, _pool_worker, (void *) (size_t) (k + 1)) != 0)
+            break;
+
+    pthread_mutex_lock(&_pool.busy);
+    _pool.workers = k;
+    pthread_mutex_unlock(&_pool.busy);
+
+    if (k + 1 < threads) {
+        winternitz_pool_stop();
+        return WINTERNITZ_ERROR;
+    }
+
+    return WINTERNITZ_OK;
+}
+
+void winternitz_pool_stop(void) {
+    unsigned int k;
+
+    pthread_mutex_lock(&_pool.busy); // waits for the job in flight, the next ones run on their own thread
+    pthread_mutex_lock(&_pool.lock);
+    _pool.stop = 1;
+    pthread_cond_broadcast(&_pool.start);
+    pthread_mutex_unlock(&_pool.lock);
+
+    for (k = 0; k < _pool.workers; k++)
+        pthread_join(_pool.worker[k], NULL);
+    _pool.workers = 0;
+    _pool.running = 0;
+    pthread_mutex_unlock(&_pool.busy);
+}
+
+/**
+ * The chains are dealt longest first to the least loaded part, so that the parts end together.
+ */
+void winternitz_chains(unsigned char *const chain[], const unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned int steps[], unsigned int n) {
+    unsigned int i, j, k, t, parts, total = 0, load[WINTERNITZ_POOL_MAX] = {0}, order[WINTERNITZ_MAX_L];
+
+    for (i = 0; i < n; i++)
+        total += steps[i];
+    if (n < 2 || total < WINTERNITZ_POOL_MIN_STEPS || pthread_mutex_trylock(&_pool.busy) != 0) {
+        _chains_run(chain, X, steps, n);
+        return;
+    }
+    parts = _pool.workers + 1; // read under busy, which start and stop hold to change it
+    if (parts == 1) {
+        pthread_mutex_unlock(&_pool.busy);
+        _chains_run(chain, X, steps, n);
+        return;
+    }
+
+    // chains by decreasing length, then each one to the part with the fewest steps so far
+    for (i = 0; i < n; i++) {
+        for (j = i; j > 0 && steps[order[j - 1]] < steps[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    for (k = 0; k < parts; k++)
+        _pool.n[k] = 0;
+    for (i = 0; i < n; i++) {
+        for (t = 0, k = 1; k < parts; k++)
+            if (load[k] < load[t])
+                t = k;
+        _pool.chain[t][_pool.n[t]] = chain[order[i]];
+        _pool.steps[t][_pool.n[t]++] = steps[order[i]];
+        load[t] += steps[order[i]];
+    }
+
+    pthread_mutex_lock(&_pool.lock);
+    _pool.X = X;
+    _pool.pending = _pool.workers;
+    _pool.generation++;
+    pthread_cond_broadcast(&_pool.start);
+    pthread_mutex_unlock(&_pool.lock);
+
+    _pool_run(0);
+
+    pthread_mutex_lock(&_pool.lock);
+    while (_pool.pending > 0)
+        pthread_cond_wait(&_pool.done, &_pool.lock);
+    pthread_mutex_unlock(&_pool.lock);
+
+    pthread_mutex_unlock(&_pool.busy);
+}
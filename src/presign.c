@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "presign.h"
+
+static uint64_t _elapsed_ns(const struct timespec *t0, const struct timespec *t1) {
+    return (uint64_t) (t1->tv_sec - t0->tv_sec) * 1000000000ULL + (uint64_t) t1->tv_nsec - (uint64_t) t0->tv_nsec;
+}
+
+static void _sleep_ns(uint64_t ns) {
+    struct timespec t;
+
+    t.tv_sec = (time_t) (ns / 1000000000ULL);
+    t.tv_nsec = (long) (ns % 1000000000ULL);
+    nanosleep(&t, NULL);
+}
+
+static void *_presign_producer(void *arg) {
+    struct mss_presign *ring = arg;
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)];
+    struct timespec t0, t1;
+    uint64_t tail, wanted;
+
+    while (!__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE) && ring->next < ring->end) {
+        // the signer is past these leaves: only advance the seed
+        wanted = __atomic_load_n(&ring->wanted, __ATOMIC_ACQUIRE);
+        while (ring->next < wanted && ring->next < ring->end) {
+            fsgen(ring->seed, ring->seed, ri);
+            ring->next++;
+        }
+        if (ring->next >= ring->end)
+            break;
+
+        tail = ring->tail; // only written here
+        if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->depth) {
+            _sleep_ns(PRESIGN_IDLE_NS);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        fsgen(ring->seed, ring->seed, ri);
+        mss_presign_leaf(ring->hash_mode, ring->next, ri, &ring->slot[tail % ring->depth]);
+        ring->next++;
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        // stay within the CPU budget: idle (100 - budget)/budget of the time just spent working
+        if (ring->cpu_budget < 100)
+            _sleep_ns(_elapsed_ns(&t0, &t1) * (100 - ring->cpu_budget) / ring->cpu_budget);
+    }
+    memset(ri, 0, sizeof ri);
+
+    return NULL;
+}
+
+unsigned char mss_presign_start(struct mss_presign *ring, const unsigned char seed[LEN_BYTES(WINTERNITZ_N)], uint64_t leaf_index, unsigned char hash_mode, unsigned int depth, unsigned int cpu_budget) {
+    memset(ring, 0, sizeof *ring);
+    if (depth == 0 || cpu_budget == 0)
+        return MSS_ERROR;
+
+    ring->slot = malloc((size_t) depth * sizeof (struct mss_presigned));
+    if (ring->slot == NULL)
+        return MSS_ERROR;
+    ring->depth = depth;
+    ring->cpu_budget = (cpu_budget > 100) ? 100 : cpu_budget;
+    ring->head = ring->tail = 0;
+    ring->wanted = ring->next = leaf_index;
+#if MSS_HEIGHT == 64
+    ring->end = UINT64_MAX;
+#else
+    ring->end = (uint64_t) 1 << MSS_HEIGHT;
+#endif
+    memcpy(ring->seed, seed, LEN_BYTES(WINTERNITZ_N));
+    ring->hash_mode = hash_mode;
+
+    if (pthread_create(&ring->thread, NULL, _presign_producer, ring) != 0) {
+        free(ring->slot);
+        memset(ring, 0, sizeof *ring);
+        return MSS_ERROR;
+    }
+
+    return MSS_OK;
+}
+
+void mss_presign_stop(struct mss_presign *ring) {
+    if (ring->slot == NULL)
+        return; // mss_presign_start failed, or the ring is already stopped: there is no thread to join
+
+    __atomic_store_n(&ring->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(ring->thread, NULL);
+
+    memset(ring->slot, 0, (size_t) ring->depth * sizeof (struct mss_presigned)); // the slots hold WOTS secrets
+    free(ring->slot);
+    memset(ring->seed, 0, sizeof ring->seed);
+    ring->slot = NULL;
+    ring->depth = 0;
+}
+
+const struct mss_presigned *mss_presign_get(struct mss_presign *ring, uint64_t leaf_index) {
+    uint64_t head = ring->head, tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE); // head is only written by the consumer
+
+    __atomic_store_n(&ring->wanted, leaf_index, __ATOMIC_RELEASE);
+
+    // the dropped slots hold the WOTS secrets of leaves that will never be signed
+    while (head < tail && ring->slot[head % ring->depth].index < leaf_index) {
+        memset(&ring->slot[head % ring->depth], 0, sizeof (struct mss_presigned));
+        head++;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+    if (head < tail && ring->slot[head % ring->depth].index == leaf_index)
+        return &ring->slot[head % ring->depth];
+
+    return NULL;
+}
+
+void mss_presign_release(struct mss_presign *ring) {
+    uint64_t head = ring->head;
+
+    memset(&ring->slot[head % ring->depth], 0, sizeof (struct mss_presigned));
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+unsigned int mss_presign_occupancy(const struct mss_presign *ring) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    return (unsigned int) (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head);
+}
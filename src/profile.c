@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * One profile of params.h: winternitz.c and mss.c compiled for the MSS_HEIGHT, MSS_K and WINTERNITZ_W given
+ * on the command line, with their external symbols suffixed by MSS_PROFILE (e.g. mss_sign_10_2_2) so that
+ * any number of profiles link next to each other and to the default build. The hash layer and the thread pool
+ * of winternitz_pool_start are shared.
+ */
+
+#if !defined(MSS_PROFILE) || !defined(MSS_HEIGHT) || !defined(MSS_K) || !defined(WINTERNITZ_W)
+#error MSS_PROFILE, MSS_HEIGHT, MSS_K and WINTERNITZ_W must be given
+#endif
+
+#ifndef SERIALIZATION
+#define SERIALIZATION
+#endif
+
+#include "params.h"
+
+#define _PROFILE_CAT2(a, b) a##_##b
+#define _PROFILE_CAT(a, b) _PROFILE_CAT2(a, b)
+#define _PROFILE(f) _PROFILE_CAT(f, MSS_PROFILE)
+#define _PROFILE_STR2(s) #s
+#define _PROFILE_STR(s) _PROFILE_STR2(s)
+
+// "profile_<MSS_PROFILE>.h", which the makefile generates from nm: one _PROFILE define per external symbol a first
+// build of this profile without it defines, so that nothing new in winternitz.c or mss.c is left out
+#ifdef MSS_PROFILE_SYMBOLS
+#include MSS_PROFILE_SYMBOLS
+#endif
+
+#include "winternitz.c"
+#include "mss.c"
+
+struct _profile_signer {
+    struct mss_state state;
+    uint64_t index;                         // next leaf
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)]; // the next fsgen gives the WOTS seed of leaf index
+    struct mss_node authpath[MSS_HEIGHT];   // of the last signature: a right leaf is read from authpath[0]
+};
+
+static void _profile_keygen(const unsigned char seed[MSS_PARAMS_SEED_SIZE], void *signer, unsigned char *pkey, unsigned char hash_mode) {
+    struct _profile_signer *sg = signer;
+    struct mss_node node[2];
+    mmo_t hash1, hash2;
+
+    mss_keygen_core(&hash1, &hash2, seed, &node[0], &node[1], &sg->state, pkey, hash_mode);
+    pkey[NODE_VALUE_SIZE] = hash_mode;
+    sg->index = 0;
+    memcpy(sg->si, seed, LEN_BYTES(WINTERNITZ_N));
+    memset(sg->authpath, 0, sizeof sg->authpath);
+}
+
+static unsigned char _profile_sign(void *signer, const unsigned char *digest, unsigned char *signature) {
+    struct _profile_signer *sg = signer;
+    struct mss_node node[3];
+    struct mss_iovec iov = { digest, NODE_VALUE_SIZE };
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)], h[LEN_BYTES(WINTERNITZ_N)], ots[MSS_OTS_SIZE], randomizer[MSS_RANDOMIZER_SIZE];
+    mmo_t hash1;
+
+#if MSS_HEIGHT < 64
+    if (sg->index >> MSS_HEIGHT)
+        return MSS_ERROR;
+#endif
+    fsgen(sg->si, sg->si, ri);
+    if (sg->index % 2 == 1 && sg->authpath[0].index != sg->index) // right leaf of a loaded signer
+        _create_leaf(&hash1, sg->state.hash_mode, &sg->authpath[0], sg->index, ri);
+    mss_sign_core_grind(&sg->state, sg->si, ri, &node[0], &iov, 1, &hash1, h, sg->index, &node[1], &node[2], ots, sg->authpath, MSS_GRIND_ATTEMPTS, randomizer);
+    sg->index++;
+    memset(signature, 0, MSS_SIGNATURE_SIZE); // serialize_mss_node leaves the end of each MSS_NODE_SIZE slot
+    serialize_mss_signature(ots, node[0], sg->authpath, randomizer, signature);
+    memset(ri, 0, sizeof ri);
+
+    return MSS_OK;
+}
+
+static unsigned char _profile_verify(const unsigned char *signature, const unsigned char *pkey, const unsigned char *digest) {
+    return mss_verify(signature, pkey, digest);
+}
+
+static void _profile_save(const void *signer, unsigned char *skey) {
+    const struct _profile_signer *sg = signer;
+
+    serialize_mss_skey(sg->state, sg->index, sg->si, skey);
+}
+
+static void _profile_load(void *signer, const unsigned char *skey) {
+    struct _profile_signer *sg = signer;
+
+    deserialize_mss_skey(&sg->state, &sg->index, sg->si, skey);
+    memset(sg->authpath, 0, sizeof sg->authpath); // not in the skey, the next right leaf is recomputed
+}
+
+static void _profile_ots_keygen(const unsigned char s[MSS_PARAMS_SEED_SIZE], unsigned char *v) {
+    winternitz_keygen(s, X, v);
+}
+
+static void _profile_ots_sign(const unsigned char s[MSS_PARAMS_SEED_SIZE], const unsigned char *h, unsigned char *sig) {
+    unsigned char d[LEN_BYTES(WINTERNITZ_N)];
+
+    memcpy(d, h, sizeof d);
+    winternitz_sign(s, X, d, sig);
+}
+
+static unsigned char _profile_ots_verify(const unsigned char *v, const unsigned char *h, const unsigned char *sig) {
+    unsigned char d[LEN_BYTES(WINTERNITZ_N)], y[LEN_BYTES(WINTERNITZ_N)];
+
+    memcpy(d, h, sizeof d);
+    return (winternitz_verify(v, X, d, sig, y) == WINTERNITZ_OK ? MSS_OK : MSS_ERROR);
+}
+
+const struct mss_params _PROFILE(mss_params) = {
+    _PROFILE_STR(MSS_PROFILE), MSS_HEIGHT, MSS_K, WINTERNITZ_W,
+    sizeof (struct _profile_signer), MSS_SKEY_SIZE, MSS_PKEY_SIZE, MSS_SIGNATURE_SIZE, NODE_VALUE_SIZE, MSS_OTS_SIZE,
+    _profile_keygen, _profile_sign, _profile_verify, _profile_save, _profile_load,
+    _profile_ots_keygen, _profile_ots_sign, _profile_ots_verify
+};
@@ -34,6 +34,8 @@
 #include <string.h>
 
 #include "sph_sha2.h"
+#include "sha2_ni.h"
+#include "dispatch.h"
 
 #if SPH_SMALL_FOOTPRINT && !defined SPH_SMALL_FOOTPRINT_SHA2
 #define SPH_SMALL_FOOTPRINT_SHA2   1
@@ -602,15 +604,24 @@ static const sph_u32 K[64] = {
 
 #endif
 
+/* see sph_sha2.h */
+void
+sph_sha256_comp_block(const unsigned char *data, sph_u32 r[8])
+{
+#define SHA2_IN(x)   sph_dec32be(data + (4 * (x)))
+	SHA2_ROUND_BODY(SHA2_IN, r);
+#undef SHA2_IN
+}
+
 /*
- * One round of SHA-224 / SHA-256. The data must be aligned for 32-bit access.
+ * The compression function actually used by the hashing code, installed
+ * by the dispatch layer (dispatch.c): the SHA extensions backend
+ * (sha2_ni.c) when available, or sph_sha256_comp_block otherwise.
  */
 static void
 sha2_round(const unsigned char *data, sph_u32 r[8])
 {
-#define SHA2_IN(x)   sph_dec32be_aligned(data + (4 * (x)))
-	SHA2_ROUND_BODY(SHA2_IN, r);
-#undef SHA2_IN
+	dispatch.comp(data, r);
 }
 
 /* see sph_sha2.h */
@@ -680,6 +691,26 @@ sph_sha256_addbits_and_close(void *cc, unsigned ub, unsigned n, void *dst)
 	sph_sha256_init(cc);
 }
 
+/* see sph_sha2.h */
+void
+sph_sha224_clone(void *dst, const void *src)
+{
+	const sph_sha224_context *sc;
+	sph_sha224_context *dc;
+
+	sc = src;
+	dc = dst;
+	memcpy(dc->val, sc->val, sizeof sc->val);
+#if SPH_64
+	dc->count = sc->count;
+	memcpy(dc->buf, sc->buf, (unsigned)sc->count & 63U);
+#else
+	dc->count_high = sc->count_high;
+	dc->count_low = sc->count_low;
+	memcpy(dc->buf, sc->buf, (unsigned)sc->count_low & 63U);
+#endif
+}
+
 /* see sph_sha2.h */
 void
 sph_sha224_comp(const sph_u32 msg[16], sph_u32 val[8])
@@ -688,3 +719,167 @@ sph_sha224_comp(const sph_u32 msg[16], sph_u32 val[8])
 	SHA2_ROUND_BODY(SHA2_IN, val);
 #undef SHA2_IN
 }
+
+/*
+ * K[t] + W[t] for the padding block of a 64-byte message (0x80, zeros,
+ * then the bit length 512), whose message schedule is a constant.
+ */
+static const sph_u32 KW_PAD64[64] = {
+	SPH_C32(0xC28A2F98), SPH_C32(0x71374491), SPH_C32(0xB5C0FBCF),
+	SPH_C32(0xE9B5DBA5), SPH_C32(0x3956C25B), SPH_C32(0x59F111F1),
+	SPH_C32(0x923F82A4), SPH_C32(0xAB1C5ED5), SPH_C32(0xD807AA98),
+	SPH_C32(0x12835B01), SPH_C32(0x243185BE), SPH_C32(0x550C7DC3),
+	SPH_C32(0x72BE5D74), SPH_C32(0x80DEB1FE), SPH_C32(0x9BDC06A7),
+	SPH_C32(0xC19BF374), SPH_C32(0x649B69C1), SPH_C32(0xF0FE4786),
+	SPH_C32(0x0FE1EDC6), SPH_C32(0x240CF254), SPH_C32(0x4FE9346F),
+	SPH_C32(0x6CC984BE), SPH_C32(0x61B9411E), SPH_C32(0x16F988FA),
+	SPH_C32(0xF2C65152), SPH_C32(0xA88E5A6D), SPH_C32(0xB019FC65),
+	SPH_C32(0xB9D99EC7), SPH_C32(0x9A1231C3), SPH_C32(0xE70EEAA0),
+	SPH_C32(0xFDB1232B), SPH_C32(0xC7353EB0), SPH_C32(0x3069BAD5),
+	SPH_C32(0xCB976D5F), SPH_C32(0x5A0F118F), SPH_C32(0xDC1EEEFD),
+	SPH_C32(0x0A35B689), SPH_C32(0xDE0B7A04), SPH_C32(0x58F4CA9D),
+	SPH_C32(0xE15D5B16), SPH_C32(0x007F3E86), SPH_C32(0x37088980),
+	SPH_C32(0xA507EA32), SPH_C32(0x6FAB9537), SPH_C32(0x17406110),
+	SPH_C32(0x0D8CD6F1), SPH_C32(0xCDAA3B6D), SPH_C32(0xC0BBBE37),
+	SPH_C32(0x83613BDA), SPH_C32(0xDB48A363), SPH_C32(0x0B02E931),
+	SPH_C32(0x6FD15CA7), SPH_C32(0x521AFACA), SPH_C32(0x31338431),
+	SPH_C32(0x6ED41A95), SPH_C32(0x6D437890), SPH_C32(0xC39C91F2),
+	SPH_C32(0x9ECCABBD), SPH_C32(0xB5C9A0E6), SPH_C32(0x532FB63C),
+	SPH_C32(0xD2C741C6), SPH_C32(0x07237EA3), SPH_C32(0xA4954B68),
+	SPH_C32(0x4C191D76)
+};
+
+/*
+ * 64 rounds driven by a precomputed K[t] + W[t] table.
+ */
+static void
+sha2_round_kw(const sph_u32 kw[64], sph_u32 r[8])
+{
+	sph_u32 A, B, C, D, E, F, G, H, T1, T2;
+	int t;
+
+	A = r[0];
+	B = r[1];
+	C = r[2];
+	D = r[3];
+	E = r[4];
+	F = r[5];
+	G = r[6];
+	H = r[7];
+	for (t = 0; t < 64; t ++) {
+		T1 = SPH_T32(H + BSG2_1(E) + CH(E, F, G) + kw[t]);
+		T2 = SPH_T32(BSG2_0(A) + MAJ(A, B, C));
+		H = G;
+		G = F;
+		F = E;
+		E = SPH_T32(D + T1);
+		D = C;
+		C = B;
+		B = A;
+		A = SPH_T32(T1 + T2);
+	}
+	r[0] = SPH_T32(r[0] + A);
+	r[1] = SPH_T32(r[1] + B);
+	r[2] = SPH_T32(r[2] + C);
+	r[3] = SPH_T32(r[3] + D);
+	r[4] = SPH_T32(r[4] + E);
+	r[5] = SPH_T32(r[5] + F);
+	r[6] = SPH_T32(r[6] + G);
+	r[7] = SPH_T32(r[7] + H);
+}
+
+#ifdef CPU_X86
+static const unsigned char PAD64[64] = {
+	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00
+};
+
+/*
+ * Non-zero when the SHA extensions backend is in use. The fixed-length
+ * kernels below feed it byte blocks, since it computes the message
+ * schedule in hardware anyway; the portable path works on words.
+ */
+static int
+sha2_fixed_ni(void)
+{
+	return dispatch.comp == sha256_ni_comp;
+}
+#endif
+
+static void
+sha2_out(const sph_u32 val[8], void *dst)
+{
+	int i;
+
+	for (i = 0; i < 8; i ++)
+		sph_enc32be((unsigned char *)dst + 4 * i, val[i]);
+}
+
+/* see sph_sha2.h */
+void
+sph_sha256_fixed32(const sph_u32 iv[8], sph_u32 prelen,
+	const void *data, void *dst)
+{
+	sph_u32 val[8];
+	sph_u32 msg[16];
+	int i;
+
+	memcpy(val, iv, sizeof val);
+#ifdef CPU_X86
+	if (sha2_fixed_ni()) {
+		unsigned char block[64];
+
+		memcpy(block, data, 32);
+		memset(block + 32, 0, 24);
+		block[32] = 0x80;
+		sph_enc64be(block + 56, (sph_u64)(prelen + 32) << 3);
+		sha256_ni_comp(block, val);
+		sha2_out(val, dst);
+		return;
+	}
+#endif
+	for (i = 0; i < 8; i ++)
+		msg[i] = sph_dec32be((const unsigned char *)data + 4 * i);
+	msg[8] = SPH_C32(0x80000000);
+	for (i = 9; i < 15; i ++)
+		msg[i] = 0;
+	msg[15] = SPH_T32((prelen + 32) << 3);
+#define SHA2_IN(x)   msg[x]
+	SHA2_ROUND_BODY(SHA2_IN, val);
+#undef SHA2_IN
+	sha2_out(val, dst);
+}
+
+/* see sph_sha2.h */
+void
+sph_sha256_fixed64(const void *left, const void *right, void *dst)
+{
+	sph_u32 val[8];
+	sph_u32 msg[16];
+	int i;
+
+	memcpy(val, H256, sizeof val);
+#ifdef CPU_X86
+	if (sha2_fixed_ni()) {
+		unsigned char block[64];
+
+		memcpy(block, left, 32);
+		memcpy(block + 32, right, 32);
+		sha256_ni_comp(block, val);
+		sha256_ni_comp(PAD64, val);
+		sha2_out(val, dst);
+		return;
+	}
+#endif
+	for (i = 0; i < 8; i ++) {
+		msg[i] = sph_dec32be((const unsigned char *)left + 4 * i);
+		msg[i + 8] = sph_dec32be((const unsigned char *)right + 4 * i);
+	}
+#define SHA2_IN(x)   msg[x]
+	SHA2_ROUND_BODY(SHA2_IN, val);
+#undef SHA2_IN
+	sha2_round_kw(KW_PAD64, val);
+	sha2_out(val, dst);
+}
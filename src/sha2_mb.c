@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "sph_sha2.h"
+#include "sha2_mb.h"
+#include "sha2_ni.h"
+#include "dispatch.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+const sph_u32 sha256_K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+void sha256_mb_comp_ref(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    sph_u32 msg[16];
+    unsigned int i, t;
+
+    for (i = 0; i < n; i++) {
+        for (t = 0; t < 16; t++)
+            msg[t] = sph_dec32be(block[i] + 4 * t);
+        sph_sha256_comp(msg, val[i]);
+    }
+}
+
+#ifdef CPU_X86
+
+/*
+ * The vector engines keep one 32-bit word of every lane per vector register (word-sliced layout),
+ * so the 64 rounds below are the plain FIPS 180-4 rounds applied to all lanes at once.
+ * Lane data is transposed to/from that layout through small scratch matrices.
+ */
+#define SHA256_MB_ROUNDS(ADD, XOR, AND, OR, ROR, SHR, SET1) do { \
+        for (t = 0; t < 64; t++) { \
+            if (t >= 16) \
+                w[t & 15] = ADD(ADD(XOR(XOR(ROR(w[(t - 2) & 15], 17), ROR(w[(t - 2) & 15], 19)), SHR(w[(t - 2) & 15], 10)), w[(t - 7) & 15]), \
+                                ADD(XOR(XOR(ROR(w[(t - 15) & 15], 7), ROR(w[(t - 15) & 15], 18)), SHR(w[(t - 15) & 15], 3)), w[t & 15])); \
+            t1 = ADD(ADD(ADD(h, XOR(XOR(ROR(e, 6), ROR(e, 11)), ROR(e, 25))), XOR(AND(XOR(f, g), e), g)), ADD(SET1(sha256_K[t]), w[t & 15])); \
+            t2 = ADD(XOR(XOR(ROR(a, 2), ROR(a, 13)), ROR(a, 22)), OR(AND(b, c), AND(OR(b, c), a))); \
+            h = g; g = f; f = e; e = ADD(d, t1); \
+            d = c; c = b; b = a; a = ADD(t1, t2); \
+        } \
+    } while (0)
+
+#define V8_ADD(x, y)    _mm256_add_epi32(x, y)
+#define V8_XOR(x, y)    _mm256_xor_si256(x, y)
+#define V8_AND(x, y)    _mm256_and_si256(x, y)
+#define V8_OR(x, y)     _mm256_or_si256(x, y)
+#define V8_SHR(x, n)    _mm256_srli_epi32(x, n)
+#define V8_ROR(x, n)    _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define V8_SET1(k)      _mm256_set1_epi32((int) (k))
+
+/**
+ * 8 lanes with AVX2. Exactly SHA256_MB_LANES_AVX2 entries of val and block are used.
+ */
+__attribute__((target("avx2")))
+static void _sha256_mb_comp_avx2(sph_u32 val[][8], const unsigned char *const block[]) {
+    sph_u32 m[16][SHA256_MB_LANES_AVX2], s[8][SHA256_MB_LANES_AVX2];
+    __m256i w[16], a, b, c, d, e, f, g, h, t1, t2;
+    unsigned int i, t;
+
+    for (i = 0; i < SHA256_MB_LANES_AVX2; i++) {
+        for (t = 0; t < 16; t++)
+            m[t][i] = sph_dec32be(block[i] + 4 * t);
+        for (t = 0; t < 8; t++)
+            s[t][i] = val[i][t];
+    }
+    for (t = 0; t < 16; t++)
+        w[t] = _mm256_loadu_si256((const __m256i *) m[t]);
+
+    a = _mm256_loadu_si256((const __m256i *) s[0]);
+    b = _mm256_loadu_si256((const __m256i *) s[1]);
+    c = _mm256_loadu_si256((const __m256i *) s[2]);
+    d = _mm256_loadu_si256((const __m256i *) s[3]);
+    e = _mm256_loadu_si256((const __m256i *) s[4]);
+    f = _mm256_loadu_si256((const __m256i *) s[5]);
+    g = _mm256_loadu_si256((const __m256i *) s[6]);
+    h = _mm256_loadu_si256((const __m256i *) s[7]);
+
+    SHA256_MB_ROUNDS(V8_ADD, V8_XOR, V8_AND, V8_OR, V8_ROR, V8_SHR, V8_SET1);
+
+    _mm256_storeu_si256((__m256i *) s[0], V8_ADD(a, _mm256_loadu_si256((const __m256i *) s[0])));
+    _mm256_storeu_si256((__m256i *) s[1], V8_ADD(b, _mm256_loadu_si256((const __m256i *) s[1])));
+    _mm256_storeu_si256((__m256i *) s[2], V8_ADD(c, _mm256_loadu_si256((const __m256i *) s[2])));
+    _mm256_storeu_si256((__m256i *) s[3], V8_ADD(d, _mm256_loadu_si256((const __m256i *) s[3])));
+    _mm256_storeu_si256((__m256i *) s[4], V8_ADD(e, _mm256_loadu_si256((const __m256i *) s[4])));
+    _mm256_storeu_si256((__m256i *) s[5], V8_ADD(f, _mm256_loadu_si256((const __m256i *) s[5])));
+    _mm256_storeu_si256((__m256i *) s[6], V8_ADD(g, _mm256_loadu_si256((const __m256i *) s[6])));
+    _mm256_storeu_si256((__m256i *) s[7], V8_ADD(h, _mm256_loadu_si256((const __m256i *) s[7])));
+
+    for (i = 0; i < SHA256_MB_LANES_AVX2; i++)
+        for (t = 0; t < 8; t++)
+            val[i][t] = s[t][i];
+}
+
+#define V16_ADD(x, y)   _mm512_add_epi32(x, y)
+#define V16_XOR(x, y)   _mm512_xor_si512(x, y)
+#define V16_AND(x, y)   _mm512_and_si512(x, y)
+#define V16_OR(x, y)    _mm512_or_si512(x, y)
+#define V16_SHR(x, n)   _mm512_srli_epi32(x, n)
+#define V16_ROR(x, n)   _mm512_ror_epi32(x, n)
+#define V16_SET1(k)     _mm512_set1_epi32((int) (k))
+
+/**
+ * 16 lanes with AVX-512F (native rotates). Exactly SHA256_MB_LANES_AVX512 entries of val and block are used.
+ */
+__attribute__((target("avx512f")))
+static void _sha256_mb_comp_avx512(sph_u32 val[][8], const unsigned char *const block[]) {
+    sph_u32 m[16][SHA256_MB_LANES_AVX512], s[8][SHA256_MB_LANES_AVX512];
+    __m512i w[16], a, b, c, d, e, f, g, h, t1, t2;
+    unsigned int i, t;
+
+    for (i = 0; i < SHA256_MB_LANES_AVX512; i++) {
+        for (t = 0; t < 16; t++)
+            m[t][i] = sph_dec32be(block[i] + 4 * t);
+        for (t = 0; t < 8; t++)
+            s[t][i] = val[i][t];
+    }
+    for (t = 0; t < 16; t++)
+        w[t] = _mm512_loadu_si512(m[t]);
+
+    a = _mm512_loadu_si512(s[0]);
+    b = _mm512_loadu_si512(s[1]);
+    c = _mm512_loadu_si512(s[2]);
+    d = _mm512_loadu_si512(s[3]);
+    e = _mm512_loadu_si512(s[4]);
+    f = _mm512_loadu_si512(s[5]);
+    g = _mm512_loadu_si512(s[6]);
+    h = _mm512_loadu_si512(s[7]);
+
+    SHA256_MB_ROUNDS(V16_ADD, V16_XOR, V16_AND, V16_OR, V16_ROR, V16_SHR, V16_SET1);
+
+    _mm512_storeu_si512(s[0], V16_ADD(a, _mm512_loadu_si512(s[0])));
+    _mm512_storeu_si512(s[1], V16_ADD(b, _mm512_loadu_si512(s[1])));
+    _mm512_storeu_si512(s[2], V16_ADD(c, _mm512_loadu_si512(s[2])));
+    _mm512_storeu_si512(s[3], V16_ADD(d, _mm512_loadu_si512(s[3])));
+    _mm512_storeu_si512(s[4], V16_ADD(e, _mm512_loadu_si512(s[4])));
+    _mm512_storeu_si512(s[5], V16_ADD(f, _mm512_loadu_si512(s[5])));
+    _mm512_storeu_si512(s[6], V16_ADD(g, _mm512_loadu_si512(s[6])));
+    _mm512_storeu_si512(s[7], V16_ADD(h, _mm512_loadu_si512(s[7])));
+
+    for (i = 0; i < SHA256_MB_LANES_AVX512; i++)
+        for (t = 0; t < 8; t++)
+            val[i][t] = s[t][i];
+}
+
+void sha256_mb_comp_ni(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i + 1 < n; i += 2)
+        sha256_ni_comp_x2(block[i], val[i], block[i + 1], val[i + 1]);
+    if (i < n)
+        sha256_ni_comp(block[i], val[i]);
+}
+
+/**
+ * Run a vector engine of the given width over n lanes. A remainder of at most tail_max lanes is handed
+ * to the tail function, a larger one is padded with copies of its first lane into scratch chaining values
+ * which are then discarded.
+ */
+static void _sha256_mb_comp_vec(sph_u32 val[][8], const unsigned char *const block[], unsigned int n, unsigned int lanes,
+                                void (*engine)(sph_u32 val[][8], const unsigned char *const block[]),
+                                unsigned int tail_max, void (*tail)(sph_u32 val[][8], const unsigned char *const block[], unsigned int n)) {
+    sph_u32 v[SHA256_MB_MAX_LANES][8];
+    const unsigned char *b[SHA256_MB_MAX_LANES];
+    unsigned int i;
+
+    while (n >= lanes) {
+        engine(val, block);
+        val += lanes;
+        block += lanes;
+        n -= lanes;
+    }
+
+    if (n <= tail_max) { // not worth a vector pass
+        tail(val, block, n);
+        return;
+    }
+
+    for (i = 0; i < lanes; i++) {
+        b[i] = block[i < n ? i : 0];
+        memcpy(v[i], val[i < n ? i : 0], sizeof v[i]);
+    }
+    engine(v, b);
+    memcpy(val, v, n * sizeof v[0]);
+}
+
+void sha256_mb_comp_avx2(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    _sha256_mb_comp_vec(val, block, n, SHA256_MB_LANES_AVX2, _sha256_mb_comp_avx2, 2, sha256_mb_comp_ref);
+}
+
+void sha256_mb_comp_avx512(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    _sha256_mb_comp_vec(val, block, n, SHA256_MB_LANES_AVX512, _sha256_mb_comp_avx512, 2, sha256_mb_comp_ref);
+}
+
+void sha256_mb_comp_avx512_ni(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    _sha256_mb_comp_vec(val, block, n, SHA256_MB_LANES_AVX512, _sha256_mb_comp_avx512, SHA256_MB_LANES_AVX512 / 2, sha256_mb_comp_ni);
+}
+
+#endif // CPU_X86
+
+void sha256_mb_comp(sph_u32 val[][8], const unsigned char *const block[], unsigned int n) {
+    dispatch.mb_comp(val, block, n);
+}
+
+unsigned int sha256_mb_lanes(void) {
+    return dispatch.mb_lanes;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Geovandro Pereira
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sha2_ni.h"
+#include "sha2_mb.h"
+
+#ifdef CPU_X86
+
+#include <immintrin.h>
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1")))
+
+/*
+ * The SHA extensions keep the state as two vectors ABEF and CDGH. The 64 rounds are done in 16 groups of 4:
+ * each group adds the round constants to a message vector and runs sha256rnds2 twice. Message vectors live
+ * in a ring of 4, and from group 3 onwards the next ones are expanded with sha256msg1/sha256msg2
+ * (Intel, "New Instructions Supporting the Secure Hash Algorithm on Intel Architecture Processors", 2013).
+ */
+
+SHA_NI_TARGET
+static inline void _ni_load_state(const sph_u32 val[8], __m128i *abef, __m128i *cdgh) {
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &val[0]), 0xB1); // CDAB
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &val[4]), 0x1B); // EFGH
+
+    *abef = _mm_alignr_epi8(tmp, efgh, 8);
+    *cdgh = _mm_blend_epi16(efgh, tmp, 0xF0);
+}
+
+SHA_NI_TARGET
+static inline void _ni_store_state(sph_u32 val[8], __m128i abef, __m128i cdgh) {
+    __m128i tmp = _mm_shuffle_epi32(abef, 0x1B); // FEBA
+
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1); // DCHG
+    _mm_storeu_si128((__m128i *) &val[0], _mm_blend_epi16(tmp, cdgh, 0xF0)); // DCBA
+    _mm_storeu_si128((__m128i *) &val[4], _mm_alignr_epi8(cdgh, tmp, 8)); // HGFE
+}
+
+// One group of 4 rounds on message ring m, i being the group number
+#define NI_GROUP(abef, cdgh, m, i) do { \
+        __m128i msg = _mm_add_epi32(m[(i) & 3], _mm_loadu_si128((const __m128i *) &sha256_K[4 * (i)])); \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg); \
+        if ((i) >= 3 && (i) <= 14) { \
+            m[((i) + 1) & 3] = _mm_add_epi32(m[((i) + 1) & 3], _mm_alignr_epi8(m[(i) & 3], m[((i) - 1) & 3], 4)); \
+            m[((i) + 1) & 3] = _mm_sha256msg2_epu32(m[((i) + 1) & 3], m[(i) & 3]); \
+        } \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E)); \
+        if ((i) >= 1 && (i) <= 12) \
+            m[((i) - 1) & 3] = _mm_sha256msg1_epu32(m[((i) - 1) & 3], m[(i) & 3]); \
+    } while (0)
+
+SHA_NI_TARGET
+void sha256_ni_comp(const unsigned char *data, sph_u32 val[8]) {
+    const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+    __m128i abef, cdgh, abef_save, cdgh_save, m[4];
+    int i;
+
+    _ni_load_state(val, &abef, &cdgh);
+    abef_save = abef;
+    cdgh_save = cdgh;
+
+    for (i = 0; i < 4; i++)
+        m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), bswap);
+
+    for (i = 0; i < 16; i++)
+        NI_GROUP(abef, cdgh, m, i);
+
+    _ni_store_state(val, _mm_add_epi32(abef, abef_save), _mm_add_epi32(cdgh, cdgh_save));
+}
+
+SHA_NI_TARGET
+void sha256_ni_comp_x2(const unsigned char *data0, sph_u32 val0[8], const unsigned char *data1, sph_u32 val1[8]) {
+    const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+    __m128i abef0, cdgh0, abef0_save, cdgh0_save, m0[4];
+    __m128i abef1, cdgh1, abef1_save, cdgh1_save, m1[4];
+    int i;
+
+    _ni_load_state(val0, &abef0, &cdgh0);
+    _ni_load_state(val1, &abef1, &cdgh1);
+    abef0_save = abef0;
+    cdgh0_save = cdgh0;
+    abef1_save = abef1;
+    cdgh1_save = cdgh1;
+
+    for (i = 0; i < 4; i++) {
+        m0[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data0 + 16 * i)), bswap);
+        m1[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data1 + 16 * i)), bswap);
+    }
+
+    for (i = 0; i < 16; i++) {
+        NI_GROUP(abef0, cdgh0, m0, i);
+        NI_GROUP(abef1, cdgh1, m1, i);
+    }
+
+    _ni_store_state(val0, _mm_add_epi32(abef0, abef0_save), _mm_add_epi32(cdgh0, cdgh0_save));
+    _ni_store_state(val1, _mm_add_epi32(abef1, abef1_save), _mm_add_epi32(cdgh1, cdgh1_save));
+}
+
+#endif // CPU_X86
@@ -16,9 +16,14 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "test.h"
 #include "mss.h"
+#include "dispatch.h"
+#include "presign.h"
+#include "params.h"
 
 #ifdef VERBOSE
 #include "util.h"
@@ -38,19 +43,44 @@ unsigned char seed[LEN_BYTES(WINTERNITZ_N)] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA
 unsigned char h1[HASH_LEN], h2[HASH_LEN];
 unsigned char sig_bench[WINTERNITZ_L*HASH_LEN];
 unsigned char aux[HASH_LEN];
+extern unsigned char X[LEN_BYTES(WINTERNITZ_N)]; // the public seed of mss.c
 
-unsigned short test_mss_signature() {
+/**
+ * The root reached from the leaf of index with authpath, each parent being SHA-256(left || right) over the 32-byte
+ * values of its children
+ */
+static void _climb(const unsigned char leaf[NODE_VALUE_SIZE], uint64_t index, const struct mss_node authpath[MSS_HEIGHT], unsigned char root[NODE_VALUE_SIZE]) {
+    sph_sha256_context ctx;
+    unsigned int h;
+
+    memcpy(root, leaf, NODE_VALUE_SIZE);
+    for (h = 0; h < MSS_HEIGHT; h++, index >>= 1) {
+        sph_sha256_init(&ctx);
+        if (index & 1) {
+            sph_sha256(&ctx, authpath[h].value, NODE_VALUE_SIZE);
+            sph_sha256(&ctx, root, NODE_VALUE_SIZE);
+        } else {
+            sph_sha256(&ctx, root, NODE_VALUE_SIZE);
+            sph_sha256(&ctx, authpath[h].value, NODE_VALUE_SIZE);
+        }
+        sph_sha256_close(&ctx, root);
+    }
+}
+
+unsigned short test_mss_signature(unsigned char hash_mode) {
 
     unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
     unsigned short errors;
     uint64_t j;
+    struct mss_node leaf;
 
-    char M[16] = "--Hello, world!!";
+    char M[] = "--Hello, world!!";
+    struct mss_iovec iov[3] = { { M, 2 }, { &M[2], 0 }, { &M[2], sizeof M - 4 } }; // the same message as M, strlen(M)-1, in pieces
 
     MMO_init(&hash1);
 
     // Compute Merkle Public Key and TreeHash state        
-    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test);
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, hash_mode);
 
 #if defined(VERBOSE) && defined(DEBUG)
     Display("Merkle Public Key", pkey_test, NODE_VALUE_SIZE);
@@ -67,13 +97,35 @@ unsigned short test_mss_signature() {
         printf("Testing MSS for leaf %llu ...", j);
         #endif
         fsgen(si, si, ri);
-        mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, M, strlen(M)-1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+        if (j % 2 == 0)
+            mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, M, strlen(M)-1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+        else
+            mss_sign_core_iov(&state_bench, si, ri, &currentLeaf_bench, iov, 3, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
 
         #if defined(VERBOSE) && defined(DEBUG)
         Display("", sig_bench, 16);
          #endif
 
-        if (mss_verify_core(authpath_bench, M, strlen(M)-1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test) == MSS_OK) {
+        if (hash_mode == MSS_HASH_SHA256) {
+            // the public key is the root of Hash(left || right) over the node values
+            _climb(currentLeaf_bench.value, j, authpath_bench, h2);
+            errors += (memcmp(h2, pkey_test, NODE_VALUE_SIZE) != 0);
+
+            // the leaf is Hash(v) of the one-time key of ri
+            winternitz_keygen(ri, X, h2);
+            hash32(h2, HASH_LEN, h2);
+            errors += (memcmp(h2, currentLeaf_bench.value, NODE_VALUE_SIZE) != 0);
+        }
+        // and the leaf salts the message hash
+        etcr_hash(currentLeaf_bench.value, NODE_VALUE_SIZE, M, strlen(M) - 1, h2);
+        errors += (memcmp(h1, h2, HASH_LEN) != 0);
+
+        // the OTS ends the chains of that one-time key: keygen and sign derive the same private blocks
+        winternitz_keygen(ri, X, h2);
+        errors += (winternitz_verify(h2, X, h1, sig_bench, aux) != WINTERNITZ_OK);
+
+        leaf = currentLeaf_bench; // verification overwrites it
+        if (mss_verify_core(authpath_bench, M, strlen(M)-1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, hash_mode) == MSS_OK) {
             #if defined(VERBOSE) && defined(DEBUG)
             printf(" [OK]\n");
             #endif
@@ -83,6 +135,28 @@ unsigned short test_mss_signature() {
             printf(" [ERROR]\n");
             #endif
         }
+
+        // nor may it verify any other message
+        currentLeaf_bench = leaf;
+        if (mss_verify_core(authpath_bench, M, strlen(M)-2, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, hash_mode) == MSS_OK)
+            errors++;
+
+        // nor under the other hash mode
+        currentLeaf_bench = leaf;
+        if (mss_verify_core(authpath_bench, M, strlen(M)-1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, !hash_mode) == MSS_OK)
+            errors++;
+
+        // nor with another OTS: the climb starts from the leaf recomputed from it, not from the one given
+        currentLeaf_bench = leaf;
+        sig_bench[0] ^= 1;
+        if (mss_verify_core(authpath_bench, M, strlen(M)-1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, hash_mode) == MSS_OK)
+            errors++;
+        sig_bench[0] ^= 1;
+
+        // the segmented message is the same message, whichever way it was signed
+        currentLeaf_bench = leaf;
+        if (mss_verify_core_iov(authpath_bench, iov, 3, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, hash_mode) != MSS_OK)
+            errors++;
     }
 
     return errors;
@@ -110,19 +184,1126 @@ int test_AES128() {
     return res;
 }
 
+int test_SHA256() {
+    int res;
+    unsigned char digest[HASH_LEN], msg[2 * 64 + 7];
+    sph_sha256_context ctx;
+    // FIPS 180-2 examples: "abc" (one block) and the 56-byte message (two blocks)
+    unsigned char expected1[HASH_LEN] = {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+                                         0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+    unsigned char expected2[HASH_LEN] = {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+                                         0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1};
+
+    hash32((const unsigned char *) "abc", 3, digest);
+    res = memcmp(digest, expected1, HASH_LEN);
+
+    hash32((const unsigned char *) "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, digest);
+    res |= memcmp(digest, expected2, HASH_LEN);
+
+    // the same message fed with an unaligned start and in odd pieces must not depend on the buffering
+    memcpy(msg + 7, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56);
+    sph_sha256_init(&ctx);
+    sph_sha256(&ctx, msg + 7, 5);
+    sph_sha256(&ctx, msg + 12, 51);
+    sph_sha256_close(&ctx, digest);
+    res |= memcmp(digest, expected2, HASH_LEN);
+
+    // the fixed-length kernels must agree with the generic code on 32- and 64-byte inputs
+    hash32(msg + 7, HASH_LEN, expected1);
+    hash32_fixed32(msg + 7, digest);
+    res |= memcmp(digest, expected1, HASH_LEN);
+    hash32(msg + 7, 2 * HASH_LEN, expected1);
+    hash32_fixed64(msg + 7, msg + 7 + HASH_LEN, digest);
+    res |= memcmp(digest, expected1, HASH_LEN);
+
+#ifdef VERBOSE
+    if (res)
+        Display("SHA256 digest", digest, HASH_LEN);
+#endif 
+
+    return res;
+}
+
+unsigned short test_etcr() {
+    unsigned short errors = 0;
+    unsigned int len, split, i;
+    unsigned char r[HASH_LEN], data[3 * 64 + 1], randomized[5 * 64], h[HASH_LEN], expected[HASH_LEN];
+    etcr_t ctx;
+
+    for (i = 0; i < sizeof r; i++)
+        r[i] = (unsigned char) (0xF0 ^ i);
+    for (i = 0; i < sizeof data; i++)
+        data[i] = (unsigned char) (5 * i + 3);
+
+    for (len = 0; len <= sizeof data; len++) {
+        // direct computation: rp || (data || 0x80 || 0...) xor rp, rp being the 32-byte salt twice
+        memset(randomized, 0, sizeof randomized);
+        memcpy(&randomized[64], data, len);
+        randomized[64 + len] = 0x80;
+        for (i = 0; i < 64 * (len / 64 + 2); i++)
+            randomized[i] ^= r[i % HASH_LEN];
+        hash32(randomized, 64 * (len / 64 + 2), expected);
+
+        etcr_hash(r, HASH_LEN, (const char *) data, len, h);
+        errors += (memcmp(h, expected, HASH_LEN) != 0);
+
+        // the streaming API must not depend on how the data is split
+        for (split = 0; split <= len; split += 13) {
+            etcr_init(&ctx, r, HASH_LEN);
+            etcr_update(&ctx, data, split);
+            etcr_update(&ctx, &data[split], (len - split) / 2);
+            etcr_update(&ctx, &data[split + (len - split) / 2], len - split - (len - split) / 2);
+            etcr_final(&ctx, h);
+            errors += (memcmp(h, expected, HASH_LEN) != 0);
+        }
+    }
+
+    return errors;
+}
+
+static unsigned char _is_zero(const void *p, size_t len) {
+    const unsigned char *b = p;
+    unsigned char acc = 0;
+
+    while (len--)
+        acc |= *b++;
+
+    return acc == 0;
+}
+
+unsigned short test_mss_grind() {
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)], randomizer[MSS_RANDOMIZER_SIZE];
+    unsigned char plain[32], h0[HASH_LEN];
+    unsigned short errors = 0;
+    unsigned long cost = 0, cost0 = 0;
+    uint64_t j;
+    struct mss_node leaf;
+    char M[] = "--Hello, world!!";
+    struct mss_iovec iov[2] = { { M, sizeof M - 1 }, { randomizer, MSS_RANDOMIZER_SIZE } };
+
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, MSS_HASH_SHA256);
+    memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+
+    for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+        fsgen(si, si, ri);
+        mss_sign_core_grind(&state_bench, si, ri, &currentLeaf_bench, iov, 1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench, 16, randomizer);
+
+        // never worse than the first randomizer, which is what a single attempt gives
+        memcpy(plain, M, sizeof M - 1);
+        memset(&plain[sizeof M - 1], 0, MSS_RANDOMIZER_SIZE);
+        etcr_hash(currentLeaf_bench.value, NODE_VALUE_SIZE, (const char *) plain, sizeof M - 1 + MSS_RANDOMIZER_SIZE, h0);
+        cost += winternitz_verify_cost(h1);
+        cost0 += winternitz_verify_cost(h0);
+        errors += (winternitz_verify_cost(h1) > winternitz_verify_cost(h0));
+
+        leaf = currentLeaf_bench;
+        if (mss_verify_core_iov(authpath_bench, iov, 2, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, MSS_HASH_SHA256) != MSS_OK)
+            errors++;
+
+        // the randomizer is part of the signed message
+        currentLeaf_bench = leaf;
+        if (mss_verify_core_iov(authpath_bench, iov, 1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, MSS_HASH_SHA256) == MSS_OK)
+            errors++;
+    }
+
+#ifdef VERBOSE
+    printf("Average verification chain steps: %lu without grinding, %lu with 16 attempts\n", cost0 >> MSS_HEIGHT, cost >> MSS_HEIGHT);
+#endif
+
+    return errors;
+}
+
+#ifdef SERIALIZATION
+unsigned short test_mss_serialization() {
+    const size_t ots_at = MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE, path_at = ots_at + MSS_OTS_SIZE;
+    struct mss_state *loaded = calloc(1, sizeof *loaded), *signer = calloc(1, sizeof *signer);
+    unsigned char *saved = calloc(1, MSS_STATE_SIZE), *resaved = calloc(1, MSS_STATE_SIZE); // zeroed, serialize_mss_node leaves the end of each slot
+    struct mss_node node[2], v, authpath[MSS_HEIGHT], leaf, path[MSS_HEIGHT] = { { 0 } };
+    unsigned char key_seed[LEN_BYTES(WINTERNITZ_N)], si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)], t[LEN_BYTES(WINTERNITZ_N)];
+    unsigned char *keys, *signature, digest[NODE_VALUE_SIZE], slot[MSS_NODE_SIZE], ots[MSS_OTS_SIZE], randomizer[MSS_RANDOMIZER_SIZE];
+    unsigned char h[HASH_LEN], sig[WINTERNITZ_L * HASH_LEN];
+    unsigned short errors = 0;
+    uint64_t index;
+    unsigned int i, j;
+
+    // a state read back and saved again gives the same bytes, every array of it
+    mss_keygen_core(&hash1, &hash2, seed, &node[0], &node[1], signer, pkey_test, MSS_HASH_SHA256);
+    serialize_mss_state(*signer, 5, saved);
+    deserialize_mss_state(loaded, &index, saved);
+    serialize_mss_state(*loaded, index, resaved);
+    errors += (index != 5 || memcmp(saved, resaved, MSS_STATE_SIZE) != 0);
+
+    for (i = 0; i < sizeof key_seed; i++)
+        key_seed[i] = (unsigned char) (7 * i + 1); // unlike seed, its two halves differ
+    keys = mss_keygen(key_seed);
+
+    // the skey keeps all 32 bytes of the seed, and the state of the in-memory key with its unused slots zero
+    mss_keygen_core(&hash1, &hash2, key_seed, &node[0], &node[1], signer, pkey_test, MSS_HASH_SHA256);
+    serialize_mss_state(*signer, 0, saved);
+    deserialize_mss_skey(loaded, &index, t, keys);
+    serialize_mss_state(*loaded, index, resaved);
+    errors += (index != 0 || memcmp(t, key_seed, sizeof t) != 0 || memcmp(saved, resaved, MSS_STATE_SIZE) != 0);
+    errors += (memcmp(keys + MSS_SKEY_SIZE, pkey_test, NODE_VALUE_SIZE) != 0 || keys[MSS_SKEY_SIZE + NODE_VALUE_SIZE] != MSS_HASH_SHA256);
+
+    // mss_sign against the in-memory signer, on buffers of its own: a right leaf is read from the previous authpath
+    memcpy(si, key_seed, sizeof si);
+    memset(digest, 0x33, sizeof digest);
+    for (j = 0; j < 8; j++) {
+        digest[0] = (unsigned char) j;
+        signature = mss_sign(keys, digest, keys + MSS_SKEY_SIZE);
+        errors += (mss_verify(signature, keys + MSS_SKEY_SIZE, digest) != MSS_OK);
+
+        // leaf j is the one of the WOTS seed fsgen gives from the key seed, for left and right leaves alike
+        fsgen(si, si, ri);
+        winternitz_keygen(ri, X, t);
+        hash32(t, HASH_LEN, t);
+        deserialize_mss_signature(ots, &v, authpath, randomizer, signature);
+        errors += (v.index != j || memcmp(v.value, t, NODE_VALUE_SIZE) != 0);
+
+        // the layout is v || randomizer || ots || authpath
+        memset(slot, 0, sizeof slot);
+        serialize_mss_node(v, slot);
+        errors += (memcmp(signature, slot, MSS_NODE_SIZE) != 0);
+        errors += (memcmp(signature + MSS_NODE_SIZE, randomizer, MSS_RANDOMIZER_SIZE) != 0);
+        errors += (memcmp(signature + ots_at, ots, MSS_OTS_SIZE) != 0);
+        for (i = 0; i < MSS_HEIGHT; i++) {
+            memset(slot, 0, sizeof slot);
+            serialize_mss_node(authpath[i], slot);
+            errors += (memcmp(signature + path_at + i * MSS_NODE_SIZE, slot, MSS_NODE_SIZE) != 0);
+        }
+        free(signature);
+
+        mss_sign_core(signer, si, ri, &leaf, (const char *) digest, sizeof digest, &hash1, h, j, &node[0], &node[1], sig, path);
+    }
+
+    // the saved key moved on with the in-memory signer
+    serialize_mss_state(*signer, 8, saved);
+    deserialize_mss_skey(loaded, &index, t, keys);
+    serialize_mss_state(*loaded, index, resaved);
+    errors += (index != 8 || memcmp(t, si, sizeof t) != 0 || memcmp(saved, resaved, MSS_STATE_SIZE) != 0);
+
+    free(keys);
+    free(saved);
+    free(resaved);
+    free(loaded);
+    free(signer);
+
+    return errors;
+}
+
+/**
+ * Feed a serialized signature to the stream verifier in pieces of the given sizes, cycling through them
+ */
+static unsigned char _verify_stream_pieces(const unsigned char *signature, size_t len, const unsigned char *pkey, const unsigned char *digest, const size_t *piece, unsigned int npieces) {
+    struct mss_verify_stream vs;
+    size_t offset = 0, c;
+    unsigned int k = 0;
+
+    mss_verify_stream_init(&vs, pkey, digest);
+    while (offset < len) {
+        c = piece[k++ % npieces];
+        if (c > len - offset)
+            c = len - offset;
+        if (mss_verify_stream_update(&vs, signature + offset, c) != MSS_OK)
+            break;
+        offset += c;
+    }
+
+    return mss_verify_stream_final(&vs);
+}
+
+unsigned short test_mss_stream() {
+    const size_t piece[] = { 1, 7, 33, 64, 5, MSS_NODE_SIZE, 100, 31 };
+    const size_t whole = MSS_SIGNATURE_SIZE;
+    unsigned char *keys, *signature, digest[NODE_VALUE_SIZE], tampered[MSS_SIGNATURE_SIZE + 1];
+    unsigned short errors = 0;
+    unsigned int j, k;
+
+    keys = mss_keygen(seed);
+    memset(digest, 0x5A, sizeof digest);
+
+    for (j = 0; j < 16; j++) {
+        digest[0] = (unsigned char) j;
+        signature = mss_sign(keys, digest, keys + MSS_SKEY_SIZE);
+
+        errors += (mss_verify(signature, keys + MSS_SKEY_SIZE, digest) != MSS_OK);
+        errors += (_verify_stream_pieces(signature, MSS_SIGNATURE_SIZE, keys + MSS_SKEY_SIZE, digest, &whole, 1) != MSS_OK);
+        for (k = 0; k < sizeof piece / sizeof piece[0]; k++)
+            errors += (_verify_stream_pieces(signature, MSS_SIGNATURE_SIZE, keys + MSS_SKEY_SIZE, digest, &piece[k], sizeof piece / sizeof piece[0] - k) != MSS_OK);
+
+        // a flipped bit in each field, a short or long signature and another message must all be rejected
+        for (k = 0; k < 4; k++) {
+            memcpy(tampered, signature, MSS_SIGNATURE_SIZE);
+            tampered[(size_t[]) { 5, MSS_NODE_SIZE + 1, MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE + 40, MSS_SIGNATURE_SIZE - MSS_NODE_SIZE + 10 }[k]] ^= 0x10;
+            errors += (_verify_stream_pieces(tampered, MSS_SIGNATURE_SIZE, keys + MSS_SKEY_SIZE, digest, piece, 8) == MSS_OK);
+        }
+        memcpy(tampered, signature, MSS_SIGNATURE_SIZE);
+        tampered[MSS_SIGNATURE_SIZE] = 0;
+        errors += (_verify_stream_pieces(tampered, MSS_SIGNATURE_SIZE - 1, keys + MSS_SKEY_SIZE, digest, piece, 8) == MSS_OK);
+        errors += (_verify_stream_pieces(tampered, MSS_SIGNATURE_SIZE + 1, keys + MSS_SKEY_SIZE, digest, piece, 8) == MSS_OK);
+        digest[1] ^= 1;
+        errors += (_verify_stream_pieces(signature, MSS_SIGNATURE_SIZE, keys + MSS_SKEY_SIZE, digest, piece, 8) == MSS_OK);
+        digest[1] ^= 1;
+
+        free(signature);
+    }
+    free(keys);
+
+    return errors;
+}
+
+unsigned short test_mss_profiles() {
+    const struct mss_params *p;
+    unsigned char *signer, *restored, *skey, *pkey, *signature, *other, digest[NODE_VALUE_SIZE], v[NODE_VALUE_SIZE];
+    unsigned short errors = 0;
+    unsigned int i, j;
+    uint32_t widths = 0;
+
+    errors += (mss_params_find(MSS_HEIGHT, MSS_K, 17) != NULL);
+    for (i = 0; (p = mss_profiles[i]) != NULL; i++) {
+        errors += (mss_params_find(p->height, p->k, p->w) != p || p->digest_size != NODE_VALUE_SIZE);
+        widths |= (uint32_t) 1 << p->w;
+        signature = malloc(p->signature_size);
+        memset(digest, 0x5A, sizeof digest);
+
+        // a WOTS round trip, whose chunks of w bits straddle bytes unless w divides 8
+        p->ots_keygen(seed, v);
+        p->ots_sign(seed, digest, signature);
+        errors += (p->ots_verify(v, digest, signature) != MSS_OK);
+        digest[NODE_VALUE_SIZE - 1] ^= 1; // the last chunk and the checksum
+        errors += (p->ots_verify(v, digest, signature) == MSS_OK);
+        digest[NODE_VALUE_SIZE - 1] ^= 1;
+        signature[p->ots_size - 1] ^= 1;
+        errors += (p->ots_verify(v, digest, signature) == MSS_OK);
+        free(signature);
+        if (p->w > 8)
+            continue; // 2^w-1 steps a chain: a whole tree of keys takes seconds
+
+        signer = malloc(p->signer_size);
+        restored = malloc(p->signer_size);
+        skey = malloc(p->skey_size);
+        pkey = malloc(p->pkey_size);
+        signature = malloc(p->signature_size);
+        other = malloc(p->signature_size);
+        memset(digest, 0x3C, sizeof digest);
+
+        p->keygen(seed, signer, pkey, MSS_HASH_SHA256);
+        for (j = 0; j < 8; j++) {
+            digest[0] = (unsigned char) j;
+            if (j == 4) { // a saved and loaded signer goes on with the same signatures
+                p->save(signer, skey);
+                p->load(restored, skey);
+            }
+            errors += (p->sign(signer, digest, signature) != MSS_OK);
+            if (j >= 4) {
+                errors += (p->sign(restored, digest, other) != MSS_OK);
+                errors += (memcmp(signature, other, p->signature_size) != 0);
+            }
+            errors += (p->verify(signature, pkey, digest) != MSS_OK);
+            if (p->height == MSS_HEIGHT && p->k == MSS_K && p->w == WINTERNITZ_W) // the same scheme as this build
+                errors += (mss_verify(signature, pkey, digest) != MSS_OK);
+            digest[1] ^= 1;
+            errors += (p->verify(signature, pkey, digest) == MSS_OK);
+            digest[1] ^= 1;
+        }
+
+        free(signer);
+        free(restored);
+        free(skey);
+        free(pkey);
+        free(signature);
+        free(other);
+    }
+    // the test build links odd and wide w next to the defaults (MSS_TEST_PROFILES)
+    errors += ((widths & (1U << 3 | 1U << 5 | 1U << 16)) != (1U << 3 | 1U << 5 | 1U << 16));
+
+    return errors;
+}
+
+static unsigned short _states_differ(const struct mss_state *a, const struct mss_state *b);
+
+/**
+ * Whether the n bytes of s occur in the len bytes of p
+ */
+static int _contains(const void *p, size_t len, const unsigned char *s, size_t n) {
+    const unsigned char *b = p;
+    size_t i;
+
+    for (i = 0; i + n <= len; i++)
+        if (memcmp(b + i, s, n) == 0)
+            return 1;
+
+    return 0;
+}
+
+unsigned short test_mss_hypertree() {
+    struct mss_hypertree *ht = malloc(sizeof *ht);
+    struct mss_state *state = calloc(1, sizeof *state); // zeroed as the next trees, for _states_differ
+    unsigned char pkey[MSS_PKEY_SIZE], digest[NODE_VALUE_SIZE], *signature = malloc(MSS_HT_SIGNATURE_SIZE);
+    unsigned char chain[LEN_BYTES(WINTERNITZ_N)], tree[2][LEN_BYTES(WINTERNITZ_N)];
+    unsigned short errors = 0;
+    uint64_t j, n = ((uint64_t) 1 << MSS_HEIGHT) + 4; // across the first tree of layer 0
+    unsigned int l;
+
+    mss_hypertree_keygen(ht, seed, pkey, MSS_HASH_SHA256);
+    memset(digest, 0x69, sizeof digest);
+
+    // neither the master seed nor the start of a layer chain is kept
+    errors += _contains(ht, sizeof *ht, seed, LEN_BYTES(WINTERNITZ_N));
+    for (l = 0; l < MSS_LAYERS; l++) {
+        prg(seed, l, chain);
+        errors += _contains(ht, sizeof *ht, chain, LEN_BYTES(WINTERNITZ_N));
+    }
+    // the first two trees of layer 0
+    prg(seed, 0, chain);
+    fsgen(chain, chain, tree[0]);
+    fsgen(chain, chain, tree[1]);
+
+    for (j = 0; j < n && (MSS_LAYERS > 1 || j < n - 4); j++) {
+        digest[0] = (unsigned char) j;
+        errors += (mss_hypertree_sign(ht, digest, signature) != MSS_OK);
+        errors += (mss_hypertree_verify(signature, pkey, digest) != MSS_OK);
+#if MSS_LAYERS > 1
+        // the next tree of layer 0 grows by one leaf per signature, and takes over complete
+        errors += (ht->next_leaf[0] != ((j + 1) & (((uint64_t) 1 << MSS_HEIGHT) - 1)));
+        if (j + 1 == ((uint64_t) 1 << MSS_HEIGHT)) {
+            mss_keygen_core(&hash1, &hash2, tree[1], &nodes[0], &nodes[1], state, pkey_test, MSS_HASH_SHA256);
+            errors += _states_differ(&ht->state[0], state);
+            errors += _contains(ht, sizeof *ht, tree[0], LEN_BYTES(WINTERNITZ_N));
+        }
+#endif
+
+        if (j % 256 == 0 || j >= n - 8) {
+            // another message, another leaf index, and a flipped OTS bit in each layer must be rejected
+            digest[1] ^= 1;
+            errors += (mss_hypertree_verify(signature, pkey, digest) == MSS_OK);
+            digest[1] ^= 1;
+            signature[0] ^= 1;
+            errors += (mss_hypertree_verify(signature, pkey, digest) == MSS_OK);
+            signature[0] ^= 1;
+            for (l = 0; l < MSS_LAYERS; l++) {
+                signature[8 + l * MSS_SIGNATURE_SIZE + MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE + 7] ^= 0x10;
+                errors += (mss_hypertree_verify(signature, pkey, digest) == MSS_OK);
+                signature[8 + l * MSS_SIGNATURE_SIZE + MSS_NODE_SIZE + MSS_RANDOMIZER_SIZE + 7] ^= 0x10;
+            }
+        }
+    }
+#if MSS_LAYERS == 1
+    errors += (mss_hypertree_sign(ht, digest, signature) != MSS_ERROR); // all the leaves are used
+#endif
+
+    free(signature);
+    free(state);
+    free(ht);
+
+    return errors;
+}
+#endif
+
+/**
+ * Number of differing nodes among n, comparing the fields only since the padding bytes are not part of a node
+ */
+static unsigned short _nodes_differ(const struct mss_node *a, const struct mss_node *b, unsigned int n) {
+    unsigned short differ = 0;
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        differ += (a[i].height != b[i].height || a[i].index != b[i].index || memcmp(a[i].value, b[i].value, NODE_VALUE_SIZE) != 0);
+
+    return differ;
+}
+
+/**
+ * The rungs depend only on the next leaf, so they must match. A ladder only caches the seed walk of its treehash:
+ * mss_keygen_core_shards leaves them unset, as its replay has no seeds, so ladders are compared where both are set.
+ */
+static unsigned short _states_differ(const struct mss_state *a, const struct mss_state *b) {
+    unsigned short differ = 0;
+    unsigned int h;
+
+    differ += (a->hash_mode != b->hash_mode || a->stack_index != b->stack_index);
+    differ += (memcmp(a->treehash_state, b->treehash_state, sizeof a->treehash_state) != 0);
+    differ += (memcmp(a->retain_index, b->retain_index, sizeof a->retain_index) != 0);
+    differ += (memcmp(a->treehash_seed, b->treehash_seed, sizeof a->treehash_seed) != 0);
+    differ += _nodes_differ(a->treehash, b->treehash, MSS_TREEHASH_SIZE);
+#if MSS_STACK_SIZE != 0
+    differ += _nodes_differ(a->stack, b->stack, MSS_STACK_SIZE);
+#endif
+    differ += _nodes_differ(a->retain, b->retain, MSS_RETAIN_SIZE);
+    differ += _nodes_differ(a->keep, b->keep, MSS_KEEP_SIZE);
+    differ += _nodes_differ(a->auth, b->auth, MSS_HEIGHT);
+    differ += _nodes_differ(a->store, b->store, MSS_TREEHASH_SIZE - 1);
+    differ += (memcmp(a->rung_index, b->rung_index, sizeof a->rung_index) != 0);
+    differ += (memcmp(a->rung, b->rung, sizeof a->rung) != 0);
+    for (h = 0; h < MSS_TREEHASH_SIZE; h++)
+        if (a->ladder_index[h] != UINT64_MAX && b->ladder_index[h] != UINT64_MAX)
+            differ += (a->ladder_index[h] != b->ladder_index[h] || memcmp(a->ladder[h], b->ladder[h], LEN_BYTES(WINTERNITZ_N)) != 0);
+
+    return differ;
+}
+
+unsigned short test_mss_keygen_mt() {
+    static struct mss_state serial, parallel;
+    unsigned char pkey_mt[NODE_VALUE_SIZE];
+    struct mss_node root, node[2];
+    unsigned short errors = 0;
+    unsigned int i, config[][2] = { { 1, 1 }, { 1, 2 }, { 3, 4 }, { MSS_HEIGHT - 1, 3 } }; // { t, threads }
+
+    memset(&serial, 0, sizeof serial);
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &serial, pkey_test, MSS_HASH_SHA256);
+    root = nodes[0];
+
+    for (i = 0; i < sizeof config / sizeof config[0]; i++) {
+        memset(&parallel, 0, sizeof parallel);
+        memset(node, 0, sizeof node);
+        if (mss_keygen_core_mt(&hash1, &hash2, seed, &node[0], &node[1], &parallel, pkey_mt, MSS_HASH_SHA256, config[i][0], config[i][1]) != MSS_OK) {
+            errors++;
+            continue;
+        }
+        errors += (memcmp(pkey_mt, pkey_test, NODE_VALUE_SIZE) != 0);
+        errors += _states_differ(&parallel, &serial);
+        errors += _nodes_differ(&node[0], &root, 1);
+    }
+    errors += (mss_keygen_core_mt(&hash1, &hash2, seed, &node[0], &node[1], &parallel, pkey_mt, MSS_HASH_SHA256, MSS_HEIGHT, 2) != MSS_ERROR);
+    errors += (mss_keygen_core_mt(&hash1, &hash2, seed, &node[0], &node[1], &parallel, pkey_mt, MSS_HASH_SHA256, 1, 0) != MSS_ERROR);
+
+    return errors;
+}
+
+struct _shard_job {
+    struct mss_shard *shard;
+    const unsigned char *pkey;
+    unsigned short errors;
+};
+
+/**
+ * Sign and verify every leaf of one shard
+ */
+static void *_shard_signer(void *arg) {
+    struct _shard_job *job = arg;
+    struct mss_shard *shard = job->shard;
+    unsigned char ri[LEN_BYTES(WINTERNITZ_N)], h[HASH_LEN], x[HASH_LEN], sig[WINTERNITZ_SIG_SIZE];
+    struct mss_node leaf, node[2], authpath[MSS_HEIGHT];
+    char M[] = "--Hello, world!!";
+    mmo_t hash;
+
+    for (; shard->index < shard->end; shard->index++) {
+        fsgen(shard->si, shard->si, ri);
+        mss_sign_core(&shard->state, shard->si, ri, &leaf, M, sizeof M - 1, &hash, h, shard->index, &node[0], &node[1], sig, authpath);
+        job->errors += (mss_verify_core(authpath, M, sizeof M - 1, h, shard->index, sig, x, &leaf, job->pkey, MSS_HASH_SHA256) != MSS_OK);
+    }
+
+    return NULL;
+}
+
+unsigned short test_mss_shards() {
+    const unsigned int t = 2, nsub = 1 << t;
+    struct mss_shard *shard = calloc(nsub, sizeof (struct mss_shard)); // zeroed as the reference, for _states_differ
+    struct _shard_job job[1 << 2];
+    pthread_t thread[1 << 2];
+    int started[1 << 2];
+    unsigned char pkey[NODE_VALUE_SIZE], si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned short errors = 0;
+    unsigned int c, h;
+    uint64_t j;
+
+    if (mss_keygen_core_shards(seed, shard, pkey, MSS_HASH_SHA256, t, 2) != MSS_OK) {
+        free(shard);
+        return 1;
+    }
+
+    // each range starts where the serial signer would be
+    memset(&state_bench, 0, sizeof state_bench);
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, MSS_HASH_SHA256);
+    errors += (memcmp(pkey, pkey_test, NODE_VALUE_SIZE) != 0);
+    memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+    for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+        if (j % ((uint64_t) 1 << (MSS_HEIGHT - t)) == 0) {
+            c = (unsigned int) (j >> (MSS_HEIGHT - t));
+            errors += _states_differ(&shard[c].state, &state_bench);
+            for (h = 0; h < MSS_TREEHASH_SIZE; h++) // unset, as documented, so _states_differ skipped them
+                errors += (shard[c].state.ladder_index[h] != UINT64_MAX);
+            errors += (memcmp(shard[c].si, si, LEN_BYTES(WINTERNITZ_N)) != 0);
+            errors += (shard[c].index != j || shard[c].end != j + ((uint64_t) 1 << (MSS_HEIGHT - t)));
+        }
+        fsgen(si, si, ri);
+        mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, "--Hello, world!!", 16, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+    }
+
+    // all the ranges signed at once under the same public key
+    for (c = 0; c < nsub; c++) {
+        job[c].shard = &shard[c];
+        job[c].pkey = pkey;
+        job[c].errors = 0;
+        started[c] = (pthread_create(&thread[c], NULL, _shard_signer, &job[c]) == 0);
+        if (!started[c])
+            _shard_signer(&job[c]);
+    }
+    for (c = 0; c < nsub; c++) {
+        if (started[c])
+            pthread_join(thread[c], NULL);
+        errors += job[c].errors;
+    }
+
+    errors += (mss_keygen_core_shards(seed, shard, pkey, MSS_HASH_SHA256, 0, 2) != MSS_ERROR);
+    errors += (mss_keygen_core_shards(seed, shard, pkey, MSS_HASH_SHA256, MSS_HEIGHT, 2) != MSS_ERROR);
+    free(shard);
+
+    return errors;
+}
+
+unsigned short test_mss_deferred() {
+    static struct mss_state reference, deferred;
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)], sig[WINTERNITZ_SIG_SIZE];
+    unsigned short errors = 0;
+    uint64_t j;
+    int background;
+    struct mss_node leaf, authpath[MSS_HEIGHT];
+    struct mss_deferred d;
+    char M[] = "--Hello, world!!";
+    struct mss_iovec iov = { M, sizeof M - 1 };
+
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &reference, pkey_test, MSS_HASH_SHA256);
+
+    for (background = 0; background <= 1; background++) {
+        state_bench = reference;
+        deferred = reference;
+        if (mss_deferred_start(&d, &deferred, background) != MSS_OK)
+            return errors + 1;
+        memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+
+        for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+            fsgen(si, si, ri);
+            mss_sign_core_iov(&state_bench, si, ri, &currentLeaf_bench, &iov, 1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+            mss_sign_core_deferred(&d, si, ri, &leaf, &iov, 1, h2, j, sig, authpath);
+            if (!background && j % 3 == 0)
+                mss_deferred_drain(&d); // as an idle caller would; the other steps are run by the next signature
+
+            errors += (memcmp(sig, sig_bench, WINTERNITZ_SIG_SIZE) != 0);
+            errors += _nodes_differ(authpath, authpath_bench, MSS_HEIGHT);
+            if (mss_verify_core(authpath, M, sizeof M - 1, h2, j, sig, aux, &leaf, pkey_test, MSS_HASH_SHA256) != MSS_OK)
+                errors++;
+        }
+        mss_deferred_stop(&d);
+    }
+
+    return errors;
+}
+
+unsigned short test_mss_budget() {
+    static struct mss_state reference, budgeted;
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)], sig[WINTERNITZ_SIG_SIZE];
+    unsigned short errors = 0;
+    uint64_t j, budget[] = { MSS_COST_LEAF, ((MSS_HEIGHT - MSS_K) / 2) * MSS_COST_LEAF };
+    unsigned int b;
+    struct mss_node leaf, authpath[MSS_HEIGHT];
+    char M[] = "--Hello, world!!";
+
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &reference, pkey_test, MSS_HASH_SHA256);
+
+    for (b = 0; b < sizeof budget / sizeof budget[0]; b++) {
+        state_bench = reference;
+        budgeted = reference;
+        budgeted.budget = budget[b];
+        memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+
+        for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+            fsgen(si, si, ri);
+            mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, M, sizeof M - 1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+            mss_sign_core(&budgeted, si, ri, &leaf, M, sizeof M - 1, &hash1, h2, j, &nodes[0], &nodes[1], sig, authpath);
+
+            errors += (memcmp(sig, sig_bench, WINTERNITZ_SIG_SIZE) != 0);
+            errors += _nodes_differ(authpath, authpath_bench, MSS_HEIGHT);
+            // leaves computed ahead only take what the BDS updates left of the budget
+            errors += (budgeted.work > state_bench.work && budgeted.work > budget[b]);
+        }
+    }
+
+    return errors;
+}
+
+/**
+ * Errors in the seed checkpoints of state after signing leaf s: each one is unset and zero, or ahead of leaf s+1
+ * and on the fsgen chain, whose seed before leaf i is chain[i]. The rungs sit 3*2^h leaves after s+1.
+ */
+static unsigned short _ladders_differ(const struct mss_state *state, const unsigned char (*chain)[LEN_BYTES(WINTERNITZ_N)], uint64_t s) {
+    const unsigned char zero[LEN_BYTES(WINTERNITZ_N)] = {0};
+    unsigned short differ = 0;
+    uint64_t r;
+    unsigned int h;
+
+    for (h = 0; h < MSS_TREEHASH_SIZE; h++) {
+        if (state->ladder_index[h] == UINT64_MAX)
+            differ += (memcmp(state->ladder[h], zero, sizeof zero) != 0);
+        else
+            differ += (state->ladder_index[h] <= s + 1 || memcmp(state->ladder[h], chain[state->ladder_index[h]], sizeof zero) != 0);
+
+        r = s + 1 + 3 * ((uint64_t) 1 << h);
+        if (r < ((uint64_t) 1 << MSS_HEIGHT))
+            differ += (state->rung_index[h] != r || memcmp(state->rung[h], chain[r], sizeof zero) != 0);
+        else
+            differ += (state->rung_index[h] != UINT64_MAX || memcmp(state->rung[h], zero, sizeof zero) != 0);
+    }
+
+    return differ;
+}
+
+unsigned short test_mss_ladder() {
+    // a traversal step computes (H-K)/2 leaves at most, each one fsgen or two from its ladder, plus one per rung
+    const uint64_t bound = MSS_TREEHASH_SIZE * MSS_COST_FSGEN + MSS_COST_PARENT
+                           + ((MSS_HEIGHT - MSS_K) / 2) * (2 * MSS_COST_FSGEN + MSS_COST_LEAF + (MSS_HEIGHT - MSS_K) * MSS_COST_PARENT);
+    unsigned char (*chain)[LEN_BYTES(WINTERNITZ_N)], si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned short errors = 0;
+    uint64_t j, budget[] = { 0, MSS_COST_LEAF };
+    unsigned int b;
+    char M[] = "--Hello, world!!";
+
+    chain = malloc((((uint64_t) 1 << MSS_HEIGHT) + 1) * sizeof *chain);
+    if (chain == NULL)
+        return 1;
+    memcpy(chain[0], seed, LEN_BYTES(WINTERNITZ_N));
+    for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++)
+        fsgen(chain[j], chain[j + 1], ri);
+
+    for (b = 0; b < sizeof budget / sizeof budget[0]; b++) {
+        mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, MSS_HASH_SHA256);
+        state_bench.budget = budget[b];
+        errors += _ladders_differ(&state_bench, (const unsigned char (*)[LEN_BYTES(WINTERNITZ_N)]) chain, (uint64_t) -1);
+
+        for (j = 0; j + 1 < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+            fsgen(chain[j], si, ri);
+            mss_sign_core(&state_bench, si, ri, &currentLeaf_bench, M, sizeof M - 1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+            errors += _ladders_differ(&state_bench, (const unsigned char (*)[LEN_BYTES(WINTERNITZ_N)]) chain, j);
+            errors += (budget[b] == 0 && state_bench.work > bound);
+        }
+    }
+    memset(chain, 0, (((uint64_t) 1 << MSS_HEIGHT) + 1) * sizeof *chain);
+    free(chain);
+
+    return errors;
+}
+
+unsigned short test_mss_presign() {
+    unsigned char si[LEN_BYTES(WINTERNITZ_N)], ri[LEN_BYTES(WINTERNITZ_N)];
+    unsigned short errors = 0;
+    uint64_t j;
+    struct mss_presign ring;
+    const struct mss_presigned *pre;
+    char M[] = "--Hello, world!!";
+    struct mss_iovec iov = { M, sizeof M - 1 };
+
+    mss_keygen_core(&hash1, &hash2, seed, &nodes[0], &nodes[1], &state_bench, pkey_test, MSS_HASH_SHA256);
+    memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+    if (mss_presign_start(&ring, si, 0, MSS_HASH_SHA256, 8, 100) != MSS_OK)
+        return 1;
+
+    for (j = 0; j < ((uint64_t) 1 << MSS_HEIGHT); j++) {
+        fsgen(si, si, ri);
+        if (j % 8 == 5) {
+            // may or may not be ready: fall back to signing from ri
+            pre = mss_presign_get(&ring, j);
+        } else {
+            while ((pre = mss_presign_get(&ring, j)) == NULL)
+                ;
+            errors += (memcmp(pre->ri, ri, LEN_BYTES(WINTERNITZ_N)) != 0);
+        }
+        errors += (mss_presign_occupancy(&ring) > 8);
+
+        if (pre != NULL) {
+            mss_sign_core_presigned(&state_bench, si, pre, &currentLeaf_bench, &iov, 1, &hash1, h1, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+            mss_presign_release(&ring);
+        } else {
+            mss_sign_core_iov(&state_bench, si, ri, &currentLeaf_bench, &iov, 1, &hash1, h1, j, &nodes[0], &nodes[1], sig_bench, authpath_bench);
+        }
+
+        if (mss_verify_core(authpath_bench, M, sizeof M - 1, h1, j, sig_bench, aux, &currentLeaf_bench, pkey_test, MSS_HASH_SHA256) != MSS_OK)
+            errors++;
+    }
+    mss_presign_stop(&ring);
+
+    // the producer stops after the last 4 leaves, so the wiped slots stay observable
+    memcpy(si, seed, LEN_BYTES(WINTERNITZ_N));
+    if (mss_presign_start(&ring, si, ((uint64_t) 1 << MSS_HEIGHT) - 4, MSS_HASH_SHA256, 8, 100) != MSS_OK)
+        return errors + 1;
+    while (mss_presign_occupancy(&ring) < 4)
+        ;
+    pre = mss_presign_get(&ring, ((uint64_t) 1 << MSS_HEIGHT) - 2);
+    errors += (pre == NULL);
+    for (j = 0; j < 2; j++)
+        errors += !_is_zero(&ring.slot[j], sizeof (struct mss_presigned));
+    mss_presign_release(&ring);
+    errors += !_is_zero(&ring.slot[2], sizeof (struct mss_presigned));
+    errors += _is_zero(&ring.slot[3], sizeof (struct mss_presigned));
+    mss_presign_stop(&ring);
+
+    // a ring that failed to start has no thread to join, and stopping it twice does nothing
+    errors += (mss_presign_start(&ring, si, 0, MSS_HASH_SHA256, 0, 100) != MSS_ERROR);
+    mss_presign_stop(&ring);
+    mss_presign_stop(&ring);
+
+    return errors;
+}
+
+unsigned short test_winternitz_chunks() {
+    unsigned short errors = 0;
+    unsigned int w, i, b, l1, l2, mask, checksum, value, chunk[WINTERNITZ_MAX_L];
+    unsigned char h[HASH_LEN];
+
+    for (i = 0; i < HASH_LEN; i++)
+        h[i] = (unsigned char) (37 * i + 11);
+
+    for (w = 1; w <= 16; w++) {
+        l1 = WINTERNITZ_L1(w);
+        l2 = WINTERNITZ_L2(w);
+        mask = (1U << w) - 1;
+        winternitz_chunks(h, w, chunk);
+
+        // bit b of h is bit (b mod w) of chunk b/w, and the padding bits of the last chunk are zero
+        for (b = 0; b < l1 * w; b++) {
+            value = (b < WINTERNITZ_N) ? (h[b / 8] >> (b % 8)) & 1 : 0;
+            errors += (((chunk[b / w] >> (b % w)) & 1) != value);
+        }
+        checksum = 0;
+        for (i = 0; i < l1; i++)
+            checksum += mask - chunk[i];
+        for (i = 0; i < l2; i++) {
+            errors += (chunk[l1 + i] > mask);
+            errors += (chunk[l1 + i] != ((checksum >> (i * w)) & mask));
+        }
+        // l2 chunks are enough for the largest checksum l1*(2^w-1)
+        errors += ((((unsigned long) l1 * mask) >> (l2 * w)) != 0);
+    }
+
+    return errors;
+}
+
+unsigned short test_winternitz_cache() {
+    unsigned short errors = 0;
+#if WINTERNITZ_CACHE_SPACING
+    unsigned int i, j;
+    unsigned char s[HASH_LEN], x[HASH_LEN], h[HASH_LEN], v[HASH_LEN], v_cache[HASH_LEN];
+    unsigned char sig[WINTERNITZ_SIG_SIZE], sig_cache[WINTERNITZ_SIG_SIZE];
+    static winternitz_cache_t cache;
+
+    for (i = 0; i < HASH_LEN; i++) {
+        s[i] = (unsigned char) (3 * i + 1);
+        x[i] = (unsigned char) (5 * i + 2);
+    }
+
+    winternitz_keygen(s, x, v);
+    winternitz_keygen_cache(s, x, v_cache, &cache);
+    errors += (memcmp(v, v_cache, HASH_LEN) != 0);
+
+    // all-zero, all-one and mixed chunks, so that chains resume from the first, the last and inner checkpoints
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < HASH_LEN; i++)
+            h[i] = (j == 0) ? 0x00 : (j == 1) ? 0xFF : (unsigned char) (29 * i + 7);
+        winternitz_sign(s, x, h, sig);
+        winternitz_sign_cache(&cache, x, h, sig_cache);
+        errors += (memcmp(sig, sig_cache, WINTERNITZ_SIG_SIZE) != 0);
+    }
+#endif
+
+    return errors;
+}
+
+unsigned short test_winternitz_ranges() {
+    unsigned short errors = 0;
+    unsigned int i, j, first;
+    unsigned char s[HASH_LEN], x[HASH_LEN], h[HASH_LEN], v[HASH_LEN], y[HASH_LEN];
+    unsigned char sig[WINTERNITZ_SIG_SIZE], sig_ranges[WINTERNITZ_SIG_SIZE];
+
+    for (i = 0; i < HASH_LEN; i++) {
+        s[i] = (unsigned char) (11 * i + 3);
+        x[i] = (unsigned char) (13 * i + 4);
+    }
+    winternitz_keygen(s, x, v);
+
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < HASH_LEN; i++)
+            h[i] = (j == 0) ? 0x00 : (j == 1) ? 0xFF : (unsigned char) (31 * i + 9);
+        winternitz_sign(s, x, h, sig);
+        errors += (winternitz_verify(v, x, h, sig, y) != WINTERNITZ_OK);
+
+        // the same signature from ranges of 3 chains taken last to first
+        memset(sig_ranges, 0, sizeof sig_ranges);
+        for (first = WINTERNITZ_L; first > 0; first -= (first < 3) ? first : 3)
+            winternitz_sign_chains(s, x, h, sig_ranges, (first < 3) ? 0 : first - 3, (first < 3) ? first : 3);
+        errors += (memcmp(sig, sig_ranges, WINTERNITZ_SIG_SIZE) != 0);
+    }
+
+#if WINTERNITZ_PRG_SECRETS
+    // h = 0 gives chunk 0 to the first chain, whose block is then its private block prg(s, 0)
+    prg(s, 0, y);
+    memset(h, 0, HASH_LEN);
+    winternitz_sign(s, x, h, sig);
+    errors += (memcmp(sig, y, HASH_LEN) != 0);
+#endif
+
+    return errors;
+}
+
+/**
+ * Sign the same digest over and over on a thread of its own, see test_winternitz_pool
+ */
+struct _pool_signer {
+    unsigned char *s, *x, *h, *sig;
+    unsigned short errors;
+};
+
+static void *_pool_signer_run(void *arg) {
+    struct _pool_signer *ps = arg;
+    unsigned char sig[WINTERNITZ_SIG_SIZE];
+    unsigned int i;
+
+    for (i = 0; i < 256; i++) {
+        winternitz_sign(ps->s, ps->x, ps->h, sig);
+        ps->errors += (memcmp(sig, ps->sig, WINTERNITZ_SIG_SIZE) != 0);
+    }
+
+    return NULL;
+}
+
+unsigned short test_winternitz_pool() {
+    unsigned short errors = 0;
+    unsigned int i, j;
+    unsigned char s[HASH_LEN], x[HASH_LEN], h[3][HASH_LEN], v[HASH_LEN], v_pool[HASH_LEN], y[HASH_LEN];
+    unsigned char sig[3][WINTERNITZ_SIG_SIZE], sig_pool[WINTERNITZ_SIG_SIZE], ots[WINTERNITZ_MAX_L * HASH_LEN];
+    const struct mss_params *p;
+    struct _pool_signer signer;
+    pthread_t thread;
+
+    for (i = 0; i < HASH_LEN; i++) {
+        s[i] = (unsigned char) (17 * i + 5);
+        x[i] = (unsigned char) (19 * i + 6);
+        for (j = 0; j < 3; j++)
+            h[j][i] = (j == 0) ? 0x00 : (j == 1) ? 0xFF : (unsigned char) (37 * i + 11);
+    }
+
+    // reference values on the calling thread only
+    winternitz_keygen(s, x, v);
+    for (j = 0; j < 3; j++)
+        winternitz_sign(s, x, h[j], sig[j]);
+
+    errors += (winternitz_pool_start(0) != WINTERNITZ_ERROR);
+    errors += (winternitz_pool_start(WINTERNITZ_POOL_MAX + 1) != WINTERNITZ_ERROR);
+    if (winternitz_pool_start(4) != WINTERNITZ_OK)
+        return errors + 1;
+    errors += (winternitz_pool_start(2) != WINTERNITZ_ERROR); // already running
+
+    winternitz_keygen(s, x, v_pool);
+    errors += (memcmp(v, v_pool, HASH_LEN) != 0);
+    for (j = 0; j < 3; j++) {
+        winternitz_sign(s, x, h[j], sig_pool);
+        errors += (memcmp(sig[j], sig_pool, WINTERNITZ_SIG_SIZE) != 0);
+        errors += (winternitz_verify(v, x, h[j], sig_pool, y) != WINTERNITZ_OK);
+    }
+    sig_pool[0] ^= 1;
+    errors += (winternitz_verify(v, x, h[2], sig_pool, y) == WINTERNITZ_OK);
+
+    // the profiles of params.h deal their own chain counts to the same pool
+    for (i = 0; (p = mss_profiles[i]) != NULL; i++) {
+        if (p->w > 8)
+            continue;
+        p->ots_keygen(s, v_pool);
+        p->ots_sign(s, h[2], ots);
+        errors += (p->ots_verify(v_pool, h[2], ots) != MSS_OK);
+        ots[0] ^= 1;
+        errors += (p->ots_verify(v_pool, h[2], ots) == MSS_OK);
+    }
+
+    winternitz_pool_stop();
+
+    // a restarted pool must not replay the last job of the previous one
+    for (i = 0; i < 2; i++) {
+        if (winternitz_pool_start(3) != WINTERNITZ_OK)
+            return errors + 1;
+        for (j = 0; j < 3; j++) {
+            winternitz_sign(s, x, h[j], sig_pool);
+            errors += (memcmp(sig[j], sig_pool, WINTERNITZ_SIG_SIZE) != 0);
+        }
+        winternitz_pool_stop();
+    }
+
+    // one thread runs no worker, but is still a running pool
+    if (winternitz_pool_start(1) != WINTERNITZ_OK)
+        return errors + 1;
+    errors += (winternitz_pool_start(2) != WINTERNITZ_ERROR);
+    winternitz_pool_stop();
+
+    // the pool stopped and restarted under a signing thread: a job in flight is waited for, not cut short
+    signer = (struct _pool_signer) { s, x, h[2], sig[2], 0 };
+    if (pthread_create(&thread, NULL, _pool_signer_run, &signer) != 0)
+        return errors + 1;
+    for (i = 0; i < 64; i++) {
+        errors += (winternitz_pool_start(4) != WINTERNITZ_OK);
+        winternitz_pool_stop();
+    }
+    pthread_join(thread, NULL);
+    errors += signer.errors;
+
+    return errors;
+}
+
+unsigned short test_hash_batch() {
+    unsigned short errors = 0;
+    unsigned int i, n, len;
+    unsigned int lens[3] = {HASH_LEN, 2 * HASH_LEN, 3 * HASH_LEN + 5};
+    unsigned char in[2 * HASH_MAX_LANES + 2][3 * HASH_LEN + 5], out[2 * HASH_MAX_LANES + 1][HASH_LEN], expected[HASH_LEN];
+    const unsigned char *in_ptr[2 * HASH_MAX_LANES + 2]; // one extra input for the two-input functions
+    unsigned char *out_ptr[2 * HASH_MAX_LANES + 1];
+    unsigned int steps[2 * HASH_MAX_LANES + 1];
+    uint64_t idx[2 * HASH_MAX_LANES + 2];
+
+    for (i = 0; i < 2 * HASH_MAX_LANES + 2; i++) {
+        for (len = 0; len < sizeof in[i]; len++)
+            in[i][len] = (unsigned char) (7 * i + len);
+        in_ptr[i] = in[i];
+        idx[i] = 3 * i + 1;
+    }
+    for (i = 0; i < 2 * HASH_MAX_LANES + 1; i++)
+        out_ptr[i] = out[i];
+
+    // every batch size up to two full groups plus one, so that padded and scalar tails are covered
+    for (n = 1; n <= 2 * HASH_MAX_LANES + 1; n++) {
+        for (len = 0; len < 3; len++) {
+            hash32_x(in_ptr, lens[len], out_ptr, n);
+            for (i = 0; i < n; i++) {
+                hash32(in[i], lens[len], expected);
+                errors += (memcmp(out[i], expected, HASH_LEN) != 0);
+            }
+        }
+
+        prg_x(in_ptr, idx, out_ptr, n);
+        for (i = 0; i < n; i++) {
+            prg(in[i], idx[i], expected);
+            errors += (memcmp(out[i], expected, HASH_LEN) != 0);
+        }
+
+        prg32_x(in_ptr, (const unsigned char *const *) out_ptr, out_ptr, n);
+        for (i = 0; i < n; i++) {
+            prg(in[i], idx[i], expected);
+            prg32(in[i], expected, expected);
+            errors += (memcmp(out[i], expected, HASH_LEN) != 0);
+        }
+
+        // n chains of n mod 4 steps under a common input, 0 steps leaving them untouched
+        for (i = 0; i < n; i++)
+            memcpy(out[i], in[i], HASH_LEN);
+        prg32_chain_x(out_ptr, in[n], n % 4, n);
+        for (i = 0; i < n; i++) {
+            memcpy(expected, in[i], HASH_LEN);
+            for (len = 0; len < n % 4; len++)
+                prg32(expected, in[n], expected);
+            errors += (memcmp(out[i], expected, HASH_LEN) != 0);
+        }
+
+        // ragged chains, some of them empty
+        for (i = 0; i < n; i++) {
+            memcpy(out[i], in[i], HASH_LEN);
+            steps[i] = (5 * i + n) % 7;
+        }
+        prg32_chains_x(out_ptr, in[n], steps, n);
+        for (i = 0; i < n; i++) {
+            memcpy(expected, in[i], HASH_LEN);
+            for (len = 0; len < steps[i]; len++)
+                prg32(expected, in[n], expected);
+            errors += (memcmp(out[i], expected, HASH_LEN) != 0);
+        }
+
+        // the AES based functions, in place for MMO_hash16_x
+        aes_128_encrypt_x(out_ptr, in_ptr, &in_ptr[1], n);
+        for (i = 0; i < n; i++) {
+            aes_128_encrypt(expected, in[i], in[i + 1]);
+            errors += (memcmp(out[i], expected, AES_128_BLOCK_SIZE) != 0);
+        }
+
+        MMO_hash32_x(in_ptr, &in_ptr[1], out_ptr, n);
+        for (i = 0; i < n; i++) {
+            MMO_hash32(&hash2, in[i], in[i + 1], expected);
+            errors += (memcmp(out[i], expected, AES_128_BLOCK_SIZE) != 0);
+        }
+
+        MMO_hash16_x((const unsigned char *const *) out_ptr, out_ptr, n);
+        for (i = 0; i < n; i++) {
+            MMO_hash32(&hash2, in[i], in[i + 1], expected);
+            MMO_hash16(&hash2, expected, expected);
+            errors += (memcmp(out[i], expected, AES_128_BLOCK_SIZE) != 0);
+        }
+    }
+
+    return errors;
+}
+
+/**
+ * Outputs of the dispatched primitives on fixed inputs, to be compared across backends.
+ */
+void _dispatch_outputs(unsigned char out[6][HASH_LEN]) {
+    unsigned char in[3 * HASH_LEN + 5];
+    unsigned int i;
+
+    for (i = 0; i < sizeof in; i++)
+        in[i] = (unsigned char) (3 * i + 1);
+    hash32(in, sizeof in, out[0]);
+    hash32_fixed64(in, in + HASH_LEN, out[1]);
+    prg32(in, in + HASH_LEN, out[2]);
+    prg(in, 5, out[3]);
+    memset(out[4], 0, HASH_LEN);
+    aes_128_encrypt(out[4], in, in + AES_128_BLOCK_SIZE);
+    MMO_hash16(&hash2, in, out[5]);
+    MMO_hash32(&hash2, in, in + AES_128_BLOCK_SIZE, out[5] + AES_128_BLOCK_SIZE);
+}
+
+unsigned short test_dispatch() {
+    const char *backends[6] = {"ref", "avx2", "avx512", "shani", "aesni", "native"};
+    unsigned char expected[6][HASH_LEN], out[6][HASH_LEN];
+    unsigned short errors = 0;
+    unsigned int b;
+
+    dispatch_force("ref");
+    _dispatch_outputs(expected);
+    // features the CPU lacks are dropped by the dispatcher, so every name can be tried
+    for (b = 0; b < 6; b++) {
+        dispatch_force(backends[b]);
+        _dispatch_outputs(out);
+        errors += (memcmp(out, expected, sizeof out) != 0);
+        errors += (test_SHA256() != 0);
+        errors += test_hash_batch();
+#ifdef VERBOSE
+        if (errors)
+            printf("Backend %s: %s\n", backends[b], dispatch.name);
+#endif
+    }
+    errors += (dispatch_force("sha3") != 0); // unknown names are rejected
+
+    dispatch_init(); // back to the default, or MSS_BACKEND, selection
+    return errors;
+}
+
 unsigned short do_test(enum TEST operation) {
     uint64_t errors = 0;
 
     switch (operation) {
         case TEST_MSS_SIGN:
-            errors = test_mss_signature();
+            errors = test_mss_signature(MSS_HASH_SHA256);
 #ifdef VERBOSE
             if (errors == 0) {
                 printf("Shorter Merkle signature tests: PASSED\n");
                 printf("All %u leaves tested.\n\n", (1 << MSS_HEIGHT));
             }
             else 
-                printf("Merkle Signature tests: FAILED. #Errors: %llu \n\n", errors);
+                printf("Merkle Signature tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+        break;
+        case TEST_MSS_SIGN_MMO:
+            errors = test_mss_signature(MSS_HASH_MMO);
+#ifdef VERBOSE
+            if (errors == 0) {
+                printf("Shorter Merkle signature tests, AES-MMO nodes: PASSED\n");
+                printf("All %u leaves tested.\n\n", (1 << MSS_HEIGHT));
+            }
+            else 
+                printf("Merkle Signature tests, AES-MMO nodes: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
 #endif
         break;
         case TEST_AES_ENC:
@@ -134,6 +1315,179 @@ unsigned short do_test(enum TEST operation) {
                 printf("AES128 tests: FAILED\n\n");
 #endif
             break;
+        case TEST_SHA256:
+            errors = test_SHA256();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("SHA256 tests: PASSED\n\n");
+            else 
+                printf("SHA256 tests: FAILED\n\n");
+#endif
+            break;
+        case TEST_ETCR:
+            errors = test_etcr();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Randomized hashing tests: PASSED\n\n");
+            else 
+                printf("Randomized hashing tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_DISPATCH:
+            errors = test_dispatch();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Backend dispatch tests: PASSED\n\n");
+            else 
+                printf("Backend dispatch tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_HASH_BATCH:
+            errors = test_hash_batch();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Multi-buffer hash tests: PASSED (%u lanes)\n\n", sha256_mb_lanes());
+            else 
+                printf("Multi-buffer hash tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_WINTERNITZ_CHUNKS:
+            errors = test_winternitz_chunks();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Winternitz chunk tests: PASSED (w = 1..16)\n\n");
+            else 
+                printf("Winternitz chunk tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_WINTERNITZ_RANGES:
+            errors = test_winternitz_ranges();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Winternitz chain range tests: PASSED (%s secrets)\n\n", WINTERNITZ_PRG_SECRETS ? "prg" : "fsgen");
+            else 
+                printf("Winternitz chain range tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_WINTERNITZ_POOL:
+            errors = test_winternitz_pool();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Winternitz thread pool tests: PASSED\n\n");
+            else 
+                printf("Winternitz thread pool tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_WINTERNITZ_CACHE:
+            errors = test_winternitz_cache();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Winternitz checkpoint cache tests: PASSED\n\n");
+            else 
+                printf("Winternitz checkpoint cache tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_PRESIGN:
+            errors = test_mss_presign();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Pre-signing pipeline tests: PASSED\n\n");
+            else 
+                printf("Pre-signing pipeline tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_KEYGEN_MT:
+            errors = test_mss_keygen_mt();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Parallel key generation tests: PASSED\n\n");
+            else 
+                printf("Parallel key generation tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_DEFERRED:
+            errors = test_mss_deferred();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Deferred traversal tests: PASSED\n\n");
+            else 
+                printf("Deferred traversal tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_BUDGET:
+            errors = test_mss_budget();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Budgeted traversal tests: PASSED\n\n");
+            else 
+                printf("Budgeted traversal tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_LADDER:
+            errors = test_mss_ladder();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Seed ladder tests: PASSED\n\n");
+            else 
+                printf("Seed ladder tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_SHARDS:
+            errors = test_mss_shards();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Sharded signing tests: PASSED\n\n");
+            else 
+                printf("Sharded signing tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_GRIND:
+            errors = test_mss_grind();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Grinding tests: PASSED\n\n");
+            else 
+                printf("Grinding tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+#ifdef SERIALIZATION
+        case TEST_MSS_HYPERTREE:
+            errors = test_mss_hypertree();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Hypertree tests: PASSED\n\n");
+            else 
+                printf("Hypertree tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_PROFILES:
+            errors = test_mss_profiles();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Parameter profile tests: PASSED\n\n");
+            else 
+                printf("Parameter profile tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_SERIALIZATION:
+            errors = test_mss_serialization();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Serialization tests: PASSED\n\n");
+            else 
+                printf("Serialization tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+        case TEST_MSS_STREAM:
+            errors = test_mss_stream();
+#ifdef VERBOSE
+            if (errors == 0)
+                printf("Streaming verification tests: PASSED\n\n");
+            else 
+                printf("Streaming verification tests: FAILED. #Errors: %llu \n\n", (unsigned long long) errors);
+#endif
+            break;
+#endif
         default:
             break;
     }
@@ -145,10 +1499,32 @@ unsigned short do_test(enum TEST operation) {
 int main() {
     
     printf("\nParameters:  WINTERNITZ_n=%u, Tree_Height=%u, Treehash_K=%u, WINTERNITZ_w=%u \n\n", WINTERNITZ_N, MSS_HEIGHT, MSS_K, WINTERNITZ_W);
+    printf("Backend: %s\n\n", dispatch.name);
     
     //do_test(TEST_AES_ENC);
+    do_test(TEST_SHA256);
+    do_test(TEST_HASH_BATCH);
+    do_test(TEST_DISPATCH);
+    do_test(TEST_ETCR);
+    do_test(TEST_WINTERNITZ_CHUNKS);
+    do_test(TEST_WINTERNITZ_CACHE);
+    do_test(TEST_WINTERNITZ_RANGES);
+    do_test(TEST_WINTERNITZ_POOL);
     do_test(TEST_MSS_SIGN);
-    //do_test(TEST_MSS_SERIALIZATION);
+    do_test(TEST_MSS_SIGN_MMO);
+    do_test(TEST_MSS_PRESIGN);
+    do_test(TEST_MSS_GRIND);
+    do_test(TEST_MSS_KEYGEN_MT);
+    do_test(TEST_MSS_DEFERRED);
+    do_test(TEST_MSS_BUDGET);
+    do_test(TEST_MSS_LADDER);
+    do_test(TEST_MSS_SHARDS);
+#ifdef SERIALIZATION
+    do_test(TEST_MSS_SERIALIZATION);
+    do_test(TEST_MSS_STREAM);
+    do_test(TEST_MSS_PROFILES);
+    do_test(TEST_MSS_HYPERTREE);
+#endif
     
     return 0;
 }
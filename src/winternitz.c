@@ -38,382 +38,292 @@ void winternitz_chaining(unsigned char sk[LEN_BYTES(WINTERNITZ_N)], unsigned cha
     
 }
 
-void winternitz_keygen(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char x[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)]) {
-    unsigned char i;
-    sph_sha256_context ctx;
-    
-    sph_sha256_init(&ctx); // Context for the hash y = H(y_1 || ... || y_L)
-    
-    for (i = 0; i < WINTERNITZ_L; i++) {                        // chunk count, including checksum
-        prg(s,i,v);                                             // v = sk_i = private block for i-th byte
-        winternitz_chaining(v, x, (1 << WINTERNITZ_W)-1, v);    // v is the hash chain of its previous value = y_i = F_{sk_i}^{2^w-1}(X)
-        sph_sha256(&ctx, v, LEN_BYTES(WINTERNITZ_N));
-    }
-    sph_sha256_close(&ctx, v);                                  // y = H(y_1 || ... || y_L)
-
-}
+/**
+ * The private blocks sk_first, ..., sk_{first+count-1} of the key with seed s, see WINTERNITZ_PRG_SECRETS.
+ */
+static void _winternitz_secrets(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned int first, unsigned int count, unsigned char *const sk[]) {
+    unsigned int i;
+#if WINTERNITZ_PRG_SECRETS
+    hmac_t prf;
 
-#if WINTERNITZ_W == 2
+    prg_init(&prf, s); // every block is keyed by s, expand it once
+    for (i = 0; i < count; i++)
+        prg_eval(&prf, first + i, sk[i]); // sk_i = prg(s, i)
+    memset(&prf, 0, sizeof prf);
+#else
+    unsigned char seed_i[LEN_BYTES(WINTERNITZ_N)], skip[LEN_BYTES(WINTERNITZ_N)];
 
-void winternitz_2_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
-    unsigned char i, seed_i[LEN_BYTES(WINTERNITZ_N)];
-    unsigned short checksum = 0;
-    
     memcpy(seed_i, s, LEN_BYTES(WINTERNITZ_N));
-    
-    // data part:
-    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // 0 part:
-        fsgen(seed_i, seed_i, sig); // (seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) where sig = s_i = private block for i-th "0" chunk
-
-        checksum += 3-(h[i] & 3);
-        
-        winternitz_chaining(sig, X, h[i] & 3, sig);
-        
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next chunk
-
-        // 1 part:
-        fsgen(seed_i, seed_i, sig); // (seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th "1" chunk             
-       
-        checksum += 3-((h[i]>> 2) & 3);
-        
-        winternitz_chaining(sig, X, (h[i]>> 2) & 3, sig);        
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next chunk
-
-        // 2 part:
-        fsgen(seed_i, seed_i, sig); // (seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th "2" chunk            
-        
-        checksum += 3-((h[i]>> 4) & 3);
-        
-        winternitz_chaining(sig, X, (h[i]>> 4) & 3, sig); 
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next chunk
-
-        // 3 part:
-        fsgen(seed_i, seed_i, sig); // (seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th "3" chunk 
-        
-        checksum += 3-((h[i]>> 6) & 3);
-        
-        winternitz_chaining(sig, X, (h[i]>> 6) & 3, sig); 
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next chunk
-    }
-
-    // checksum part:
-    for (i = 0; i < WINTERNITZ_l2; i++) { // checksum
-        fsgen(seed_i, seed_i, sig); // (seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th checksum chunk         
-
-        winternitz_chaining(sig, X, checksum & 3, sig); 
-
-        checksum >>= 2;
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next nybble
-    }
+    for (i = 0; i < first; i++)
+        fsgen(seed_i, seed_i, skip);
+    for (i = 0; i < count; i++)
+        fsgen(seed_i, seed_i, sk[i]); // (seed_{i+1}, sk_i) = F_{seed_i}(0)||F_{seed_i}(1)
+    memset(seed_i, 0, sizeof seed_i);
+    memset(skip, 0, sizeof skip);
+#endif
 }
-#endif // WINTERNITZ_W == 2
-
-
-#if WINTERNITZ_W == 4
 
-void winternitz_4_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
-    //Sign h = H(v, M) under private key s, yielding (x_{0:lo}, x_{0:hi}, ..., x_{(N/8-1):lo}, x_{(N/8-1):hi})
-    unsigned char i, c, seed_i[LEN_BYTES(WINTERNITZ_N)];
-    unsigned short checksum = 0;
-    
-    memcpy(seed_i, s, LEN_BYTES(WINTERNITZ_N));    
+/**
+ * Key generation, storing the chains at every WINTERNITZ_CACHE_SPACING steps into point when not NULL.
+ */
+static void _winternitz_keygen(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char x[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)], unsigned char (*point)[WINTERNITZ_L][LEN_BYTES(WINTERNITZ_N)]) {
+    unsigned int i, steps[WINTERNITZ_L];
+    unsigned char y[WINTERNITZ_L][LEN_BYTES(WINTERNITZ_N)];
+    unsigned char *chain[WINTERNITZ_L];
+    sph_sha256_context ctx;
     
-    // data part:
-    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // lo part:
-        fsgen(seed_i, seed_i, sig); //(seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block s_2i for i-th "lo" nybble         
-
-        c = h[i] & 15; // lo nybble
-        checksum += 15 - (unsigned short) c;
-
-#ifdef DEBUG
-        assert(c < 16);
+    for (i = 0; i < WINTERNITZ_L; i++) {                        // chunk count, including checksum
+        chain[i] = y[i];
+        steps[i] = WINTERNITZ_CHAIN_LEN;
+    }
+    _winternitz_secrets(s, 0, WINTERNITZ_L, chain);             // y_i = sk_i, the same private blocks as in winternitz_sign
+
+#if WINTERNITZ_CACHE_SPACING
+    if (point != NULL) {
+        unsigned int spacing[WINTERNITZ_L];
+
+        for (i = 0; i < WINTERNITZ_L; i++) {
+            spacing[i] = WINTERNITZ_CACHE_SPACING;
+            steps[i] -= (WINTERNITZ_CACHE_POINTS - 1) * WINTERNITZ_CACHE_SPACING;
+        }
+        memcpy(point[0], y, sizeof y);
+        for (i = 1; i < WINTERNITZ_CACHE_POINTS; i++) {
+            winternitz_chains(chain, x, spacing, WINTERNITZ_L);
+            memcpy(point[i], y, sizeof y);
+        }
+    }
 #endif
 
-        winternitz_chaining(sig, X, c, sig);
+    // all chains have the same length, advance them together: y_i = F_{sk_i}^{2^w-1}(X)
+    winternitz_chains(chain, x, steps, WINTERNITZ_L);
 
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next nybble
+    sph_sha256_init(&ctx); // Context for the hash y = H(y_1 || ... || y_L)
+    sph_sha256(&ctx, y, sizeof y);
+    sph_sha256_close(&ctx, v);                                  // y = H(y_1 || ... || y_L)
 
-        // hi part:
-        fsgen(seed_i, seed_i, sig); //(seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th "hi" nybble
+}
 
-        c = h[i] >> 4; // hi nybble
-        checksum += 15 - (unsigned short) c;
+void winternitz_keygen(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char x[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)]) {
+    _winternitz_keygen(s, x, v, NULL);
+}
 
-#ifdef DEBUG
-        assert(c < 16);
+#if WINTERNITZ_CACHE_SPACING
+void winternitz_keygen_cache(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char x[LEN_BYTES(WINTERNITZ_N)], unsigned char v[LEN_BYTES(WINTERNITZ_N)], winternitz_cache_t *cache) {
+    _winternitz_keygen(s, x, v, cache->point);
+}
 #endif
-        winternitz_chaining(sig, X, c, sig);
 
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next nybble
+/**
+ * The chunk engine for one w. Bits are taken from h through a small accumulator, so that widths which
+ * do not divide 8 simply straddle byte boundaries; the bits past N of the last chunk are zero.
+ */
+static inline void _winternitz_chunks_w(const unsigned char *h, const unsigned int w, unsigned int *chunk) {
+    const unsigned int mask = (1U << w) - 1, l1 = WINTERNITZ_L1(w), l2 = WINTERNITZ_L2(w);
+    unsigned int i, j = 0, bits = 0, checksum = 0;
+    uint32_t acc = 0;
+
+    // data part:
+    for (i = 0; i < l1; i++) {
+        while (bits < w) {
+            if (j < LEN_BYTES(WINTERNITZ_N))
+                acc |= (uint32_t) h[j++] << bits;
+            bits += 8;
+        }
+        chunk[i] = acc & mask;
+        acc >>= w;
+        bits -= w;
+        checksum += mask - chunk[i];
     }
     // checksum part:
-    for (i = 0; i < 3; i++) { // checksum
-        fsgen(seed_i, seed_i, sig); //(seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) sig holds the private block for i-th checksum nybble
-
-        c = checksum & 15; // least significant nybble
-        checksum >>= 4;
-
-#ifdef DEBUG
-        assert(c < 16);
-#endif
-        winternitz_chaining(sig, X, c, sig);
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next nybble
+    for (i = 0; i < l2; i++) {
+        chunk[l1 + i] = checksum & mask;
+        checksum >>= w;
     }
-
 }
-#endif // WINTERNITZ_W = 4
 
-#if WINTERNITZ_W == 8
+/**
+ * The chunk engine for a w dividing 8: each byte of h splits into 8/w chunks, low bits first as above, with no
+ * accumulator and no padding. With w constant the inner loop unrolls into shifts and masks of one byte.
+ */
+static inline void _winternitz_chunks_bytes(const unsigned char *h, const unsigned int w, unsigned int *chunk) {
+    const unsigned int mask = (1U << w) - 1, per = 8 / w, l1 = WINTERNITZ_L1(w), l2 = WINTERNITZ_L2(w);
+    unsigned int i, k, checksum = 0;
 
-void winternitz_8_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
-    //Sign h = H(v, M) under private key s, yielding (x_{0}, x_{1}, ..., x_{N/8-1})    
-    unsigned char i, seed_i[LEN_BYTES(WINTERNITZ_N)];
-    unsigned short c, checksum = 0;
-    
-    memcpy(seed_i, s, LEN_BYTES(WINTERNITZ_N));
-    
     // data part:
     for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // process 8-bit chunk
-        
-        fsgen(seed_i, seed_i, sig); //(seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) where sig = s_i = private block for i-th byte
-        // sig holds the private block i-th byte               
-        
-        checksum += 255 - (unsigned char) h[i];
-
-        winternitz_chaining(sig, X, h[i], sig); // sig holds the hash chain on s_i, sig = F_{s_i}^{h[i]}(X)
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next nybble
+        for (k = 0; k < per; k++) {
+            chunk[i * per + k] = (h[i] >> (k * w)) & mask;
+            checksum += mask - chunk[i * per + k];
+        }
     }
     // checksum part:
-    for (i = 0; i < WINTERNITZ_CHECKSUM_SIZE; i++) {
-        fsgen(seed_i, seed_i, sig); //(seed_{i+1}, sig) =  F_{seed_i}(0)||F_{seed_i}(1) where sig = s_i = private block for i-th byte
-        // sig holds the private block for i-th checksum unsigned char
-
-        c = checksum & 255; // least significant byte of the checksum
-        checksum >>= 8;
-
-#ifdef DEBUG
-        assert(c < 256);
-#endif
-
-        winternitz_chaining(sig, X, c, sig); // sig holds the hash chain on s_i, sig = F_{s_i}^{h[i]}(X)
-
-        sig += LEN_BYTES(WINTERNITZ_N); // signature block for next unsigned char
+    for (i = 0; i < l2; i++) {
+        chunk[l1 + i] = checksum & mask;
+        checksum >>= w;
     }
-    
 }
-#endif /* WINTERNITZ_W = 8*/
-
-void winternitz_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
 
-#if WINTERNITZ_W == 2
-    winternitz_2_sign(s, X, h, sig);
-#elif WINTERNITZ_W == 4
-    winternitz_4_sign(s, X, h, sig);
-#elif WINTERNITZ_W == 8
-    winternitz_8_sign(s, X, h, sig);
+void winternitz_chunks(const unsigned char *h, unsigned int w, unsigned int *chunk) {
+#ifdef DEBUG
+    assert(w >= 1 && w <= 16);
 #endif
+    switch (w) {
+        case 2:
+            _winternitz_chunks_bytes(h, 2, chunk);
+            break;
+        case 4:
+            _winternitz_chunks_bytes(h, 4, chunk);
+            break;
+        case 8:
+            _winternitz_chunks_bytes(h, 8, chunk);
+            break;
+        default:
+            _winternitz_chunks_w(h, w, chunk);
+            break;
+    }
 }
 
-#if WINTERNITZ_W == 2
+unsigned int winternitz_verify_cost(const unsigned char *h) {
+    unsigned int i, cost = 0, chunk[WINTERNITZ_L];
 
-unsigned char winternitz_2_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *y) {
-    unsigned char i, c;
-    unsigned short checksum = 0;
-    sph_sha256_context ctx;
+    winternitz_chunks(h, WINTERNITZ_W, chunk);
+    for (i = 0; i < WINTERNITZ_L; i++)
+        cost += (1U << WINTERNITZ_W) - 1 - chunk[i];
 
-    sph_sha256_init(&ctx);
-
-    // data part:
-
-    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // 0 part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the current signature block
-        c = 3 - ((h[i] >> 0) & 3); // chunk
-        checksum += (unsigned short) c;
-        
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
-        
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-
-        // 1 part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the current signature block
-        c = 3 - ((h[i] >> 2) & 3); // chunk
-        checksum += (unsigned short) c;
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
-        
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-
-        // 2 part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the current signature block
-        c = 3 - ((h[i] >> 4) & 3); // chunk
-        checksum += (unsigned short) c;
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
-        
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-
-        // 3 part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the current signature block
-        c = 3 - ((h[i] >> 6) & 3); // chunk
-        checksum += (unsigned short) c;
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
-        
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-    }
-    // checksum part:
-    for (i = 0; i < WINTERNITZ_l2; i++) { // checksum
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the current signature block
-        c = 3 - (checksum & 3); // chunk
-        checksum >>= 2;
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-        
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
-
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-    }
-    sph_sha256_close(&ctx, y);
-
-    return (memcmp(y, v, LEN_BYTES(WINTERNITZ_N)) == 0 ? WINTERNITZ_OK : WINTERNITZ_ERROR);
+    return cost;
 }
-#endif // WINTERNITZ_W == 2
 
-#if WINTERNITZ_W == 4
-
-unsigned char winternitz_4_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *y) {
-    unsigned char i, c;
-    unsigned short checksum = 0;
-    sph_sha256_context ctx;
-
-    sph_sha256_init(&ctx);
-    
-    // data part:
+void winternitz_sign(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
+    //Sign h = H(v, M) under private key s, yielding (x_0, x_1, ..., x_{L-1}), x_i = F_{s_i}^{chunk_i}(X)
+    winternitz_sign_chains(s, X, h, sig, 0, WINTERNITZ_L);
+}
 
-    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // lo part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the i-th signature block
-        c = 15 - (h[i] & 15); // lo nybble
-        checksum += (unsigned short) c;
+void winternitz_sign_chains(const unsigned char s[LEN_BYTES(WINTERNITZ_N)], unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned char *h, unsigned char *sig, unsigned int first, unsigned int count) {
+    unsigned int i, chunk[WINTERNITZ_L];
+    unsigned char *chain[WINTERNITZ_L];
 
 #ifdef DEBUG
-        assert(c < 16);
+    assert(first <= WINTERNITZ_L && count <= WINTERNITZ_L - first);
 #endif
+    winternitz_chunks(h, WINTERNITZ_W, chunk);
 
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
-
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
+    for (i = 0; i < count; i++)
+        chain[i] = sig + (first + i) * LEN_BYTES(WINTERNITZ_N);
+    _winternitz_secrets(s, first, count, chain); // sig_i = s_i = private block for i-th chunk
 
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-
-        // hi part:
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // x is now the i-th signature block
-        c = 15 - (h[i] >> 4); // hi nybble
-        checksum += (unsigned short) c;
-
-#ifdef DEBUG
-        assert(c < 16);
-#endif
+    // sig_i = F_{s_i}^{chunk_i}(X), the chains of different lengths share the SIMD lanes
+    winternitz_chains(chain, X, chunk + first, count);
+}
 
-        winternitz_chaining(y, X, c, y); // y holds the hash of its previous value
+#if WINTERNITZ_CACHE_SPACING
+void winternitz_sign_cache(const winternitz_cache_t *cache, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, unsigned char *sig) {
+    unsigned int i, k, chunk[WINTERNITZ_L];
+    unsigned char *chain[WINTERNITZ_L];
 
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
+    winternitz_chunks(h, WINTERNITZ_W, chunk);
 
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
+    for (i = 0; i < WINTERNITZ_L; i++) {
+        k = chunk[i] / WINTERNITZ_CACHE_SPACING;  // last checkpoint on the way to F_{s_i}^{chunk_i}(X)
+        chain[i] = sig + i * LEN_BYTES(WINTERNITZ_N);
+        memcpy(chain[i], cache->point[k][i], LEN_BYTES(WINTERNITZ_N));
+        chunk[i] -= k * WINTERNITZ_CACHE_SPACING;
     }
-    // checksum part:
-    for (i = 0; i < 3; i++) { // checksum
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the i-th signature block
-        c = 15 - (checksum & 15); // least significant nybble
-        checksum >>= 4;
 
-#ifdef DEBUG
-        assert(c < 16);
+    winternitz_chains(chain, X, chunk, WINTERNITZ_L);
+}
 #endif
 
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
+unsigned char winternitz_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *y) {
+    unsigned int i, chunk[WINTERNITZ_L];
+    unsigned char yi[WINTERNITZ_L][LEN_BYTES(WINTERNITZ_N)], *chain[WINTERNITZ_L];
+    sph_sha256_context ctx;
 
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
+    winternitz_chunks(h, WINTERNITZ_W, chunk);
 
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
+    for (i = 0; i < WINTERNITZ_L; i++) {
+#ifdef DEBUG
+        assert(chunk[i] < (1U << WINTERNITZ_W));
+#endif
+        chunk[i] = (1U << WINTERNITZ_W) - 1 - chunk[i]; // the steps left to complete the chain to y_i = F^{2^w-1}(X)
+        chain[i] = yi[i];
     }
+    memcpy(yi, sig, sizeof yi);
+    winternitz_chains(chain, X, chunk, WINTERNITZ_L);
+
+    sph_sha256_init(&ctx);
+    sph_sha256(&ctx, yi, sizeof yi);
     sph_sha256_close(&ctx, y);
 
     return (memcmp(y, v, LEN_BYTES(WINTERNITZ_N)) == 0 ? WINTERNITZ_OK : WINTERNITZ_ERROR);
 }
-#endif /* WINTERNITZ_W = 4*/
 
-#if WINTERNITZ_W == 8
-
-unsigned char winternitz_8_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *y) {
-    unsigned char i;
-    unsigned short c, checksum = 0;
-    sph_sha256_context ctx;
-
-    sph_sha256_init(&ctx);
-    
-    // data part:
-
-    for (i = 0; i < LEN_BYTES(WINTERNITZ_N); i++) {
-        // process a one-byte chunk
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N)); // y holds now the i-th signature block sigma_i
-        c = 255 - (unsigned char) h[i];          // Compute the checksum component c = 2^w-1-m_i
-        checksum += (unsigned char) c;           // Update the overall checksum with the current component CS = CS + 2^w-1-m_i
-
-#ifdef DEBUG
-        assert(c < 256);
-#endif
+void winternitz_verify_init(winternitz_stream_t *ws, unsigned char X[LEN_BYTES(WINTERNITZ_N)], const unsigned char *h) {
+    unsigned int i;
 
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
+    ws->X = X;
+    winternitz_chunks(h, WINTERNITZ_W, ws->chunk);
+    for (i = 0; i < WINTERNITZ_L; i++)
+        ws->chunk[i] = (1U << WINTERNITZ_W) - 1 - ws->chunk[i];
+    ws->t = 0;
+    ws->i = 0;
+    sph_sha256_init(&ws->ctx);
+}
 
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
+/**
+ * Complete the chains of the n blocks in yi, which are the next ones of the signature, and absorb their ends.
+ */
+static void _winternitz_verify_blocks(winternitz_stream_t *ws, unsigned char yi[][LEN_BYTES(WINTERNITZ_N)], unsigned int n) {
+    unsigned int k;
+    unsigned char *chain[HASH_MAX_LANES];
+
+    for (k = 0; k < n; k++)
+        chain[k] = yi[k];
+    winternitz_chains(chain, ws->X, ws->chunk + ws->i, n);
+    sph_sha256(&ws->ctx, yi, n * LEN_BYTES(WINTERNITZ_N));
+    ws->i += n;
+}
 
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
+unsigned char winternitz_verify_update(winternitz_stream_t *ws, const unsigned char *sig, size_t len) {
+    unsigned char yi[HASH_MAX_LANES][LEN_BYTES(WINTERNITZ_N)];
+    unsigned int n = 0, c;
+
+    if (len > (size_t) (WINTERNITZ_L - ws->i) * LEN_BYTES(WINTERNITZ_N) - ws->t)
+        return WINTERNITZ_ERROR;
+
+    while (len > 0) {
+        if (ws->t == 0 && len >= LEN_BYTES(WINTERNITZ_N)) {
+            // a whole block: straight to the batch
+            memcpy(yi[n++], sig, LEN_BYTES(WINTERNITZ_N));
+            c = LEN_BYTES(WINTERNITZ_N);
+        } else {
+            c = LEN_BYTES(WINTERNITZ_N) - ws->t;
+            if (c > len)
+                c = (unsigned int) len;
+            memcpy(ws->part + ws->t, sig, c);
+            ws->t += c;
+            if (ws->t == LEN_BYTES(WINTERNITZ_N)) {
+                memcpy(yi[n++], ws->part, LEN_BYTES(WINTERNITZ_N));
+                ws->t = 0;
+            }
+        }
+        sig += c;
+        len -= c;
+
+        if (n == HASH_MAX_LANES) {
+            _winternitz_verify_blocks(ws, yi, n);
+            n = 0;
+        }
     }
-    // checksum part:
-    for (i = 0; i < WINTERNITZ_CHECKSUM_SIZE; i++) {
-        memcpy(y, sig, LEN_BYTES(WINTERNITZ_N));    // y holds now the i-th signature block
-        c = 255 - (unsigned char) (checksum & 255); // process the least significant byte of the checksum
-        checksum >>= 8;                             // go to the next checksum byte
-
-#ifdef DEBUG
-        assert(c < 256);
-#endif
-
-        winternitz_chaining(y, X, c, y); // y holds the hash chain of its previous value
+    if (n > 0)
+        _winternitz_verify_blocks(ws, yi, n);
 
-        sph_sha256(&ctx, y, LEN_BYTES(WINTERNITZ_N));
+    return WINTERNITZ_OK;
+}
 
-        sig += LEN_BYTES(WINTERNITZ_N); // next signature block
-    }
-    sph_sha256_close(&ctx, y);
+unsigned char winternitz_verify_final(winternitz_stream_t *ws, unsigned char y[LEN_BYTES(WINTERNITZ_N)]) {
+    if (ws->i != WINTERNITZ_L || ws->t != 0)
+        return WINTERNITZ_ERROR;
+    sph_sha256_close(&ws->ctx, y);
 
-    return (memcmp(y, v, LEN_BYTES(WINTERNITZ_N)) == 0 ? WINTERNITZ_OK : WINTERNITZ_ERROR);
-    
-}
-#endif // WINTERNITZ_W = 8
-
-unsigned char winternitz_verify(const unsigned char *v, unsigned char X[LEN_BYTES(WINTERNITZ_N)], unsigned char *h, const unsigned char *sig, unsigned char *x) {
-#if WINTERNITZ_W == 2
-    return winternitz_2_verify(v, X, h, sig, x);
-#elif WINTERNITZ_W == 4
-    return winternitz_4_verify(v, X, h, sig, x);
-#elif WINTERNITZ_W == 8
-    return winternitz_8_verify(v, X, h, sig, x);
-#endif
-    return WINTERNITZ_ERROR;
+    return WINTERNITZ_OK;
 }
-